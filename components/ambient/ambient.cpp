@@ -0,0 +1,180 @@
+/**
+ * @file ambient.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/adc.h"
+#include "driver/i2s.h"
+#include "esp_adc_cal.h"
+#include "esp_log.h"
+
+#include "ambient.hpp"
+#include "filter.hpp"
+#include "board_configs.hpp"
+#include "event_loop.hpp"
+#include "leds.hpp"
+#include "static_alloc.hpp"
+#include "storage.hpp"
+
+namespace ambient {
+
+namespace {
+
+constexpr auto TAG    = "AMBIENT";
+constexpr auto *nvkey = "ambient";
+
+// the ADC runs on the I2S DMA, one frame is averaged per read, so the task
+// wakes up sample_rate / frame_samples times a second
+constexpr i2s_port_t i2s_port   = I2S_NUM_0;
+constexpr uint32_t sample_rate  = 8000;
+constexpr size_t frame_samples  = 1024;
+constexpr adc_atten_t atten     = ADC_ATTEN_DB_11;
+constexpr uint32_t default_vref = 1100;
+
+// sensor range mapped to the brightness range
+constexpr range_t range = {100, 2500, 5, 100};
+
+tracker_t tracker(range);
+
+uint16_t samples[frame_samples];
+esp_adc_cal_characteristics_t adc_chars;
+std::atomic<bool> enabled{false};
+std::atomic<uint32_t> millivolts{0};
+static_alloc::task_t<configMINIMAL_STACK_SIZE * 3> ambient_task;
+TaskHandle_t task_handle = nullptr;
+
+/**
+ * @brief the average of a frame in mV, the last filtered value if the read
+ * came back empty
+ */
+uint32_t read_frame_millivolts() {
+    size_t bytes_read = 0;
+    i2s_read(i2s_port, samples, sizeof samples, &bytes_read, portMAX_DELAY);
+    const size_t count = bytes_read / sizeof samples[0];
+    if(count == 0) {
+        return tracker.millivolts();
+    }
+    uint32_t sum = 0;
+    for(size_t i = 0; i < count; ++i) {
+        // the upper 4 bits hold the channel
+        sum += samples[i] & 0x0fff;
+    }
+    return esp_adc_cal_raw_to_voltage(sum / count, &adc_chars);
+}
+
+void apply(uint8_t brightness) {
+    ESP_LOGI(TAG, "%u mV -> bri: %03u", millivolts.load(), brightness);
+    leds::push_message({leds::channel0, brightness});
+    leds::push_message({leds::channel1, brightness});
+}
+
+void task(void *ignore) {
+    bool sampling = false;
+    while(true) {
+        // the ADC only runs while the mode is on
+        if(!enabled) {
+            if(sampling) {
+                i2s_adc_disable(i2s_port);
+                sampling = false;
+            }
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if(!sampling) {
+            tracker.reset();
+            i2s_adc_enable(i2s_port);
+            sampling = true;
+        }
+
+        const uint32_t mv = read_frame_millivolts();
+        // one line per frame, the same as host_test/data/ambient/ traces
+        ESP_LOGD(TAG, "trace: %u", mv);
+        const bool changed = tracker.update(mv);
+        millivolts         = tracker.millivolts();
+        if(changed && enabled) {
+            apply(tracker.brightness());
+        }
+    }
+}
+
+/**
+ * @brief from the event loop, set_enabled() comes from any task and the
+ * esp_timer task is no place for a commit
+ */
+void save() {
+    const uint8_t value = enabled;
+    storage::set_blob(nvkey, &value, sizeof value);
+}
+
+void adc_init() {
+    const i2s_config_t i2s_conf = {
+        .mode = static_cast<i2s_mode_t>(I2S_MODE_MASTER | I2S_MODE_RX
+                                        | I2S_MODE_ADC_BUILT_IN),
+        .sample_rate          = sample_rate,
+        .bits_per_sample      = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format       = I2S_CHANNEL_FMT_ONLY_LEFT,
+        .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+        .intr_alloc_flags     = 0,
+        .dma_buf_count        = 2,
+        .dma_buf_len          = frame_samples,
+        .use_apll             = false,
+    };
+    ESP_ERROR_CHECK(i2s_driver_install(i2s_port, &i2s_conf, 0, nullptr));
+    ESP_ERROR_CHECK(i2s_set_adc_mode(ADC_UNIT_1, board_configs::ADC_LIGHT));
+    adc1_config_channel_atten(board_configs::ADC_LIGHT, atten);
+    esp_adc_cal_characterize(ADC_UNIT_1, atten, ADC_WIDTH_BIT_12,
+                             default_vref, &adc_chars);
+}
+
+}  // namespace
+
+
+void set_enabled(bool on) {
+    if(enabled.exchange(on) == on) {
+        return;
+    }
+    ESP_LOGI(TAG, "auto brightness %s", on ? "on" : "off");
+    event_loop::post(event_loop::ambient_persist);
+    if(on) {
+        xTaskNotifyGive(task_handle);
+    }
+}
+
+bool is_enabled() {
+    return enabled;
+}
+
+uint32_t get_millivolts() {
+    return millivolts;
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    adc_init();
+
+    uint8_t value = 0;
+    size_t size   = sizeof value;
+    storage::get_blob(nvkey, &value, size);
+    enabled = value != 0;
+    event_loop::set_handler(event_loop::ambient_persist, save);
+
+    // low priority, the filter is happy with late frames
+    task_handle = ambient_task.create(task, "ambient", tskIDLE_PRIORITY + 1,
+                                      APP_CPU_NUM);
+}
+
+}  // namespace ambient
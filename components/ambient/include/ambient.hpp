@@ -0,0 +1,35 @@
+/**
+ * @file ambient.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief brightness following the ambient light
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace ambient {
+
+/**
+ * @brief set up the ADC and start sampling if the mode was left on
+ */
+void init();
+
+/**
+ * @brief turn the auto brightness on or off from any task, the choice is
+ * saved from the event loop
+ */
+void set_enabled(bool enabled);
+
+bool is_enabled();
+
+/**
+ * @brief the filtered sensor voltage
+ */
+uint32_t get_millivolts();
+
+}  // namespace ambient
@@ -0,0 +1,141 @@
+/**
+ * @file filter.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief fixed point filters for the ambient light reading, no IDF in here
+ * so they build anywhere
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace ambient {
+
+/**
+ * @brief first order low pass, y += (x - y) / 2^shift, kept in q16
+ */
+template <uint8_t shift>
+class iir_t {
+public:
+    void reset(uint32_t x) {
+        m_y = static_cast<int64_t>(x) << 16;
+        m_primed = true;
+    }
+
+    uint32_t update(uint32_t x) {
+        if(!m_primed) {
+            reset(x);
+        }
+        m_y += ((static_cast<int64_t>(x) << 16) - m_y) >> shift;
+        return value();
+    }
+
+    uint32_t value() const {
+        return static_cast<uint32_t>((m_y + (1 << 15)) >> 16);
+    }
+
+private:
+    int64_t m_y   = 0;
+    bool m_primed = false;
+};
+
+/**
+ * @brief only lets a value through once it moved at least band away from
+ * the last one let through
+ */
+template <uint8_t band>
+class hysteresis_t {
+public:
+    /**
+     * @return true if out changed
+     */
+    bool update(uint8_t in) {
+        const int diff = in - m_out;
+        if(m_primed && diff < band && diff > -band) {
+            return false;
+        }
+        m_primed = true;
+        m_out    = in;
+        return true;
+    }
+
+    uint8_t value() const {
+        return m_out;
+    }
+
+private:
+    uint8_t m_out = 0;
+    bool m_primed = false;
+};
+
+/**
+ * @brief maps the sensor voltage to a brightness [min_bri-max_bri], clamped
+ * at both ends
+ */
+constexpr uint8_t to_brightness(uint32_t mv, uint32_t dark_mv,
+                                uint32_t bright_mv, uint8_t min_bri,
+                                uint8_t max_bri) {
+    return mv <= dark_mv     ? min_bri
+           : mv >= bright_mv ? max_bri
+                             : min_bri
+                                   + (mv - dark_mv) * (max_bri - min_bri)
+                                         / (bright_mv - dark_mv);
+}
+
+/**
+ * @brief the sensor voltage range mapped to the brightness range
+ */
+struct range_t {
+    uint32_t dark_mv;
+    uint32_t bright_mv;
+    uint8_t min_bri;
+    uint8_t max_bri;
+};
+
+/**
+ * @brief the whole chain from a frame average in mV to the brightness to
+ * apply, low pass, mapping and hysteresis, the same on the device and in
+ * the trace replay
+ */
+class tracker_t {
+public:
+    explicit constexpr tracker_t(const range_t &range) : m_range(range) {}
+
+    void reset() {
+        m_filter     = {};
+        m_hysteresis = {};
+    }
+
+    /**
+     * @return true if the brightness to apply changed
+     */
+    bool update(uint32_t mv) {
+        m_filter.update(mv);
+        return m_hysteresis.update(to_brightness(
+            m_filter.value(), m_range.dark_mv, m_range.bright_mv,
+            m_range.min_bri, m_range.max_bri));
+    }
+
+    /**
+     * @brief the filtered voltage
+     */
+    uint32_t millivolts() const {
+        return m_filter.value();
+    }
+
+    uint8_t brightness() const {
+        return m_hysteresis.value();
+    }
+
+private:
+    range_t m_range;
+    // about 2 s time constant at 8 frames per second
+    iir_t<4> m_filter;
+    hysteresis_t<3> m_hysteresis;
+};
+
+}  // namespace ambient
@@ -1,12 +1,24 @@
 #pragma once
 
+#include "driver/adc.h"
 #include "driver/gpio.h"
+#include "driver/touch_pad.h"
 
 namespace board_configs {
 
 constexpr gpio_num_t GPIO_LED_IN  = GPIO_NUM_2;
 constexpr gpio_num_t GPIO_LED_OUT = GPIO_NUM_15;
 
+// supply sense, falls when the mains goes away, the caps hold the rest up
+constexpr gpio_num_t GPIO_POWER_SENSE = GPIO_NUM_35;
+
+// ambient light sensor, GPIO34
+constexpr adc1_channel_t ADC_LIGHT = ADC1_CHANNEL_6;
+
+// touch pads, T7 on GPIO27 and T9 on GPIO32, clear of the LED pins
+constexpr touch_pad_t TOUCH_PAD_A = TOUCH_PAD_NUM7;
+constexpr touch_pad_t TOUCH_PAD_B = TOUCH_PAD_NUM9;
+
 constexpr uint32_t default_task_priority = 5;
 
 }  // namespace board_configs
@@ -0,0 +1,180 @@
+/**
+ * @file effects.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "effects.hpp"
+#include "renderer.hpp"
+#include "leds.hpp"
+#include "static_alloc.hpp"
+
+namespace effects {
+
+namespace {
+
+constexpr auto TAG = "EFFECTS";
+
+constexpr uint32_t frame_budget_us = 200;
+
+renderer_t renderer;
+stats_t stats;
+bool skip_next = false;
+
+esp_timer_handle_t timer = nullptr;
+static_alloc::mutex_t effects_mutex;
+SemaphoreHandle_t mutex  = nullptr;
+
+void write(uint8_t channel, uint16_t level) {
+    leds::write_level(static_cast<leds::channel_t>(channel), level);
+}
+
+/**
+ * @brief hand the levels over to the message path, so the brightness saved
+ * and reported is the one showing
+ */
+void settle() {
+    for(uint8_t ch = 0; ch < num_channels; ++ch) {
+        leds::push_message({ch == 0 ? leds::channel0 : leds::channel1,
+                            to_brightness(renderer.level(ch))});
+    }
+}
+
+void finish() {
+    renderer.stop();
+    esp_timer_stop(timer);
+    settle();
+}
+
+void on_frame(void *ignore) {
+    const int64_t start_us = esp_timer_get_time();
+    if(skip_next) {
+        skip_next = false;
+        stats.skipped++;
+        return;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    renderer.render(start_us, write);
+    // past the last keyframe of a program that does not loop
+    if(!renderer.running()) {
+        finish();
+    }
+    xSemaphoreGive(mutex);
+
+    const auto cost_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+    stats.frames++;
+    stats.total_us += cost_us;
+    if(cost_us > stats.max_us) {
+        stats.max_us = cost_us;
+    }
+    // keep the average under the budget by giving the next frame away
+    if(cost_us > frame_budget_us) {
+        stats.overruns++;
+        skip_next = true;
+    }
+}
+
+bool start(const header_t &header, const keyframe_t *keyframes) {
+    static program_t compiled;
+    if(!compile(header, keyframes, compiled)) {
+        return false;
+    }
+
+    uint16_t from[num_channels];
+    for(uint8_t ch = 0; ch < num_channels; ++ch) {
+        const auto channel = static_cast<leds::channel_t>(ch);
+        from[ch]           = to_level(leds::get_brightness(channel));
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const bool was_running = renderer.running();
+    renderer.start(compiled, from, esp_timer_get_time());
+    if(!was_running) {
+        ESP_ERROR_CHECK(esp_timer_start_periodic(timer, frame_period_us));
+    }
+    xSemaphoreGive(mutex);
+
+    ESP_LOGI(TAG, "playing %u keyframes%s", header.count,
+             header.flags & loop ? ", looping" : "");
+    return true;
+}
+
+template <size_t N>
+bool start_builtin(const keyframe_t (&keyframes)[N], uint8_t flags) {
+    static_assert(N <= max_keyframes, "too many keyframes");
+    return start({flags, N}, keyframes);
+}
+
+}  // namespace
+
+
+bool load(const uint8_t *data, size_t len) {
+    header_t header;
+    if(len < sizeof header) {
+        return false;
+    }
+    memcpy(&header, data, sizeof header);
+    if(len != sizeof header + header.count * sizeof(keyframe_t)) {
+        return false;
+    }
+    return start(header,
+                 reinterpret_cast<const keyframe_t *>(data + sizeof header));
+}
+
+bool play(builtin_t builtin) {
+    switch(builtin) {
+        case builtin_t::none:
+            stop();
+            return true;
+        case builtin_t::breathing:
+            return start_builtin(breathing_frames, loop);
+        case builtin_t::sunrise:
+            return start_builtin(sunrise_frames, 0);
+        case builtin_t::candle:
+            return start_builtin(candle_frames, loop);
+    }
+    return false;
+}
+
+void stop() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if(renderer.running()) {
+        finish();
+    }
+    xSemaphoreGive(mutex);
+}
+
+stats_t get_stats() {
+    return stats;
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    mutex = effects_mutex.create("effects");
+    const esp_timer_create_args_t timer_args = {
+        .callback        = on_frame,
+        .arg             = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "effects",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+}
+
+}  // namespace effects
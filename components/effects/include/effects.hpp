@@ -0,0 +1,86 @@
+/**
+ * @file effects.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief keyframe animations rendered on the device
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace effects {
+
+constexpr uint8_t max_keyframes = 32;
+
+enum curve_t : uint8_t {
+    linear = 0,
+    ease   = 1,  // smoothstep
+};
+
+enum flags_t : uint8_t {
+    loop = 1U << 0,
+};
+
+/**
+ * @brief the program written over BLE is a header_t followed by count
+ * keyframe_t
+ */
+struct __attribute__((packed)) header_t {
+    uint8_t flags;
+    uint8_t count;
+};
+
+struct __attribute__((packed)) keyframe_t {
+    uint16_t duration_10ms;  // time to reach this keyframe from the last one
+    uint8_t brightness[2];   // [0-100] per channel
+    curve_t curve;
+    uint8_t jitter;  // random +- brightness added on every frame
+};
+
+static_assert(sizeof(keyframe_t) == 6, "keyframe_t is part of the BLE protocol");
+
+enum builtin_t : uint8_t {
+    none      = 0,
+    breathing = 1,
+    sunrise   = 2,
+    candle    = 3,
+};
+
+/**
+ * @brief cost of the frames, read over the diagnostics characteristic
+ */
+struct __attribute__((packed)) stats_t {
+    uint32_t frames;
+    uint32_t skipped;   // frames dropped after an overrun
+    uint32_t overruns;  // frames over the budget
+    uint32_t max_us;
+    uint32_t total_us;
+};
+
+void init();
+
+/**
+ * @brief validate a program and start playing it
+ *
+ * @return false if the program is malformed, the current effect keeps going
+ */
+bool load(const uint8_t *data, size_t len);
+
+/**
+ * @brief play one of the effects built in, none stops
+ */
+bool play(builtin_t builtin);
+
+/**
+ * @brief stop the effect, the LEDs keep the last frame
+ */
+void stop();
+
+stats_t get_stats();
+
+}  // namespace effects
@@ -0,0 +1,216 @@
+/**
+ * @file renderer.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief keyframes to duty levels, frame by frame, no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "effects.hpp"
+#include "leds.hpp"
+
+namespace effects {
+
+constexpr int64_t frame_period_us = 20 * 1000;  // 50 fps
+constexpr uint8_t num_channels    = 2;
+
+constexpr keyframe_t breathing_frames[] = {
+    {0, {10, 10}, linear, 0},
+    {200, {80, 80}, ease, 0},
+    {200, {10, 10}, ease, 0},
+};
+
+constexpr keyframe_t sunrise_frames[] = {
+    {0, {0, 0}, linear, 0},
+    {12000, {5, 0}, ease, 0},
+    {24000, {40, 20}, linear, 0},
+    {24000, {100, 100}, ease, 0},
+};
+
+constexpr keyframe_t candle_frames[] = {
+    {0, {45, 40}, linear, 4},
+    {15, {55, 50}, linear, 8},
+    {25, {40, 45}, linear, 6},
+    {10, {60, 52}, linear, 10},
+    {30, {45, 40}, ease, 4},
+};
+
+constexpr uint16_t to_level(uint8_t brightness) {
+    return (brightness > 100 ? 100 : brightness) * leds::max_level / 100;
+}
+
+constexpr uint8_t to_brightness(uint16_t level) {
+    return (level * 100 + leds::max_level / 2) / leds::max_level;
+}
+
+/**
+ * @brief a keyframe converted to what the renderer works with
+ */
+struct frame_t {
+    int64_t duration_us;
+    uint16_t level[num_channels];
+    uint16_t jitter;
+    curve_t curve;
+};
+
+struct program_t {
+    frame_t frames[max_keyframes];
+    uint8_t count;
+    uint8_t flags;
+};
+
+/**
+ * @brief check and convert a program, returns false if it is malformed
+ */
+inline bool compile(const header_t &header, const keyframe_t *keyframes,
+                    program_t &out) {
+    if(header.count == 0 || header.count > max_keyframes) {
+        return false;
+    }
+    int64_t total_us = 0;
+    for(uint8_t i = 0; i < header.count; ++i) {
+        const auto &kf = keyframes[i];
+        auto &frame    = out.frames[i];
+        frame.duration_us = kf.duration_10ms * 10 * 1000;
+        frame.level[0]    = to_level(kf.brightness[0]);
+        frame.level[1]    = to_level(kf.brightness[1]);
+        frame.jitter      = to_level(kf.jitter);
+        frame.curve       = kf.curve == ease ? ease : linear;
+        total_us += frame.duration_us;
+    }
+    // a loop that takes no time would never leave the frame callback
+    if((header.flags & loop) && total_us == 0) {
+        return false;
+    }
+    out.count = header.count;
+    out.flags = header.flags;
+    return true;
+}
+
+/**
+ * @brief plays a program from the levels showing when it starts, with
+ * fixed point math only
+ */
+class renderer_t {
+public:
+    void start(const program_t &program, const uint16_t (&from)[num_channels],
+               int64_t now_us) {
+        m_program = program;
+        memcpy(m_from, from, sizeof m_from);
+        memcpy(m_level, from, sizeof m_level);
+        m_index            = 0;
+        m_segment_start_us = now_us;
+        m_running          = true;
+    }
+
+    void stop() {
+        m_running = false;
+    }
+
+    bool running() const {
+        return m_running;
+    }
+
+    /**
+     * @brief the last level written to the channel
+     */
+    uint16_t level(uint8_t channel) const {
+        return m_level[channel];
+    }
+
+    /**
+     * @brief call write(channel, level) for each channel whose level
+     * changed by now, the renderer stops after the last keyframe of a
+     * program that does not loop
+     */
+    template <typename write_t>
+    void render(int64_t now_us, write_t write) {
+        if(!m_running) {
+            return;
+        }
+
+        // catch up on keyframes passed while we were not called, one lap at
+        // most
+        int64_t elapsed = now_us - m_segment_start_us;
+        for(uint8_t i = 0; i <= m_program.count; ++i) {
+            const auto &frame = m_program.frames[m_index];
+            if(elapsed < frame.duration_us) {
+                break;
+            }
+            memcpy(m_from, frame.level, sizeof m_from);
+            m_segment_start_us += frame.duration_us;
+            elapsed -= frame.duration_us;
+            if(++m_index == m_program.count) {
+                if(!(m_program.flags & loop)) {
+                    memcpy(m_level, frame.level, sizeof m_level);
+                    for(uint8_t ch = 0; ch < num_channels; ++ch) {
+                        write(ch, m_level[ch]);
+                    }
+                    m_running = false;
+                    return;
+                }
+                m_index = 0;
+            }
+        }
+
+        const auto &frame = m_program.frames[m_index];
+        if(elapsed >= frame.duration_us) {
+            // still behind after a lap, start the segment over
+            m_segment_start_us = now_us;
+            elapsed            = 0;
+        }
+
+        // position in the segment, q16
+        int64_t t = frame.duration_us > 0
+                        ? (elapsed << 16) / frame.duration_us
+                        : 1 << 16;
+        if(frame.curve == ease) {
+            t = (((t * t) >> 16) * ((3 << 16) - 2 * t)) >> 16;
+        }
+
+        for(uint8_t ch = 0; ch < num_channels; ++ch) {
+            int32_t level = m_from[ch]
+                            + (((frame.level[ch] - m_from[ch]) * t) >> 16);
+            if(frame.jitter != 0) {
+                const uint32_t span = 2 * frame.jitter + 1;
+                level += static_cast<int32_t>(xorshift() % span)
+                         - frame.jitter;
+            }
+            if(level < 0) {
+                level = 0;
+            }
+            else if(level > leds::max_level) {
+                level = leds::max_level;
+            }
+            if(level != m_level[ch]) {
+                m_level[ch] = level;
+                write(ch, m_level[ch]);
+            }
+        }
+    }
+
+private:
+    uint32_t xorshift() {
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 17;
+        m_rng ^= m_rng << 5;
+        return m_rng;
+    }
+
+    program_t m_program = {};
+    bool m_running      = false;
+    uint8_t m_index     = 0;  // the keyframe being approached
+    int64_t m_segment_start_us = 0;
+    uint16_t m_from[num_channels]  = {0};
+    uint16_t m_level[num_channels] = {0};  // last level written
+    uint32_t m_rng                 = 0x9e3779b9;
+};
+
+}  // namespace effects
@@ -0,0 +1,266 @@
+/**
+ * @file event_loop.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "event_loop.hpp"
+#include "board_configs.hpp"
+#include "static_alloc.hpp"
+
+namespace event_loop {
+
+namespace {
+
+constexpr auto TAG = "EVENT_LOOP";
+
+// wakes the loop to look at the deadlines again
+constexpr uint32_t rearm_bit = 1U << 31;
+static_assert(num_events < 31, "events must fit the notification value");
+
+constexpr TickType_t diagnostics_period = pdMS_TO_TICKS(1000 * 60 * 10);
+// the NimBLE host runs at configMAX_PRIORITIES - 4
+constexpr UBaseType_t boosted_priority = configMAX_PRIORITIES - 5;
+static_assert(boosted_priority > board_configs::default_task_priority,
+              "a boost has to be above the default");
+
+handler_t handlers[num_events] = {nullptr};
+
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+int64_t posted_us[num_events];  // 0 while the event is not pending
+bool armed[num_events];
+TickType_t deadlines[num_events];
+uint32_t early_bits = 0;  // posted before the task existed
+
+/* The handlers commit NVS: the values, the power fail copy, the group and
+ * the ambient flag. Sized like the OTA writer, which also writes flash; the
+ * diagnostics report the handler that went deepest and what it left, size
+ * it again from there. */
+constexpr uint32_t stack_size = 4096;
+// below this left after a handler it is reported as a warning
+constexpr UBaseType_t stack_margin = 512;
+
+latency_t latencies[num_events];
+static_alloc::task_t<stack_size> loop_task;
+UBaseType_t stack_left = stack_size;
+event_t deepest        = num_events;  // the handler that left the least
+TaskHandle_t task_handle = nullptr;
+volatile event_t running = num_events;
+bool boosted             = false;
+
+void mark_posted(event_t event, int64_t now_us) {
+    if(posted_us[event] == 0) {
+        posted_us[event] = now_us;
+    }
+}
+
+/**
+ * @brief turn the deadlines that passed into events, and tell how long to
+ * sleep until the next one
+ */
+TickType_t collect_deadlines(uint32_t &bits) {
+    const TickType_t now = xTaskGetTickCount();
+    const int64_t now_us = esp_timer_get_time();
+    TickType_t timeout   = portMAX_DELAY;
+
+    portENTER_CRITICAL(&lock);
+    for(uint8_t e = 0; e < num_events; ++e) {
+        if(!armed[e]) {
+            continue;
+        }
+        const TickType_t left = deadlines[e] - now;
+        if(static_cast<int32_t>(left) <= 0) {
+            armed[e] = false;
+            bits |= 1U << e;
+            mark_posted(static_cast<event_t>(e), now_us);
+        }
+        else if(left < timeout) {
+            timeout = left;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return timeout;
+}
+
+void dispatch(event_t event) {
+    const int64_t start_us = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    const int64_t posted = posted_us[event] ? posted_us[event] : start_us;
+    posted_us[event]     = 0;
+    portEXIT_CRITICAL(&lock);
+
+    running = event;
+    if(handlers[event] != nullptr) {
+        handlers[event]();
+    }
+    running = num_events;
+
+    const UBaseType_t left = uxTaskGetStackHighWaterMark(nullptr);
+    if(left < stack_left) {
+        stack_left = left;
+        deepest    = event;
+    }
+
+    auto &latency      = latencies[event];
+    const auto wait_us = static_cast<uint32_t>(start_us - posted);
+    const auto run_us  = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+    latency.count++;
+    latency.total_us += wait_us;
+    if(wait_us > latency.max_us) {
+        latency.max_us = wait_us;
+    }
+    if(run_us > latency.max_run_us) {
+        latency.max_run_us = run_us;
+    }
+}
+
+void log_diagnostics() {
+    for(uint8_t e = 0; e < num_events; ++e) {
+        const auto &latency = latencies[e];
+        ESP_LOGI(TAG, "event %u: %u runs, avg %u us, max %u us, run max %u us",
+                 e, latency.count,
+                 latency.count ? latency.total_us / latency.count : 0,
+                 latency.max_us, latency.max_run_us);
+    }
+    if(stack_left < stack_margin) {
+        ESP_LOGW(TAG, "stack: %u of %u bytes left, deepest after event %u",
+                 stack_left, stack_size, deepest);
+    }
+    else {
+        ESP_LOGI(TAG, "stack: %u of %u bytes left, deepest after event %u",
+                 stack_left, stack_size, deepest);
+    }
+    // by now the handlers that commit NVS have run, unlike at boot
+    static_alloc::report();
+    post_after(diagnostics, diagnostics_period);
+}
+
+void task(void *ignore) {
+    uint32_t bits = 0;
+    while(true) {
+        const TickType_t timeout = collect_deadlines(bits);
+        if(bits == 0) {
+            xTaskNotifyWait(0, UINT32_MAX, &bits, timeout);
+            bits &= ~rearm_bit;
+            collect_deadlines(bits);
+        }
+        for(uint8_t e = 0; e < num_events; ++e) {
+            if(bits & (1U << e)) {
+                dispatch(static_cast<event_t>(e));
+            }
+        }
+        bits = 0;
+    }
+}
+
+}  // namespace
+
+
+void set_handler(event_t event, handler_t handler) {
+    handlers[event] = handler;
+}
+
+void post(event_t event) {
+    const int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    mark_posted(event, now_us);
+    TaskHandle_t handle = task_handle;
+    if(handle == nullptr) {
+        early_bits |= 1U << event;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if(handle != nullptr) {
+        xTaskNotify(handle, 1U << event, eSetBits);
+    }
+}
+
+void post_from_isr(event_t event, BaseType_t *higher_priority_task_woken) {
+    const int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&lock);
+    mark_posted(event, now_us);
+    TaskHandle_t handle = task_handle;
+    if(handle == nullptr) {
+        early_bits |= 1U << event;
+    }
+    portEXIT_CRITICAL_ISR(&lock);
+
+    if(handle != nullptr) {
+        xTaskNotifyFromISR(handle, 1U << event, eSetBits,
+                           higher_priority_task_woken);
+    }
+}
+
+void post_after(event_t event, TickType_t delay) {
+    const TickType_t deadline = xTaskGetTickCount() + delay;
+    portENTER_CRITICAL(&lock);
+    if(!armed[event]
+       || static_cast<int32_t>(deadline - deadlines[event]) < 0) {
+        armed[event]     = true;
+        deadlines[event] = deadline;
+    }
+    TaskHandle_t handle = task_handle;
+    portEXIT_CRITICAL(&lock);
+
+    // the loop itself picks the deadline up before it sleeps again
+    if(handle != nullptr && handle != xTaskGetCurrentTaskHandle()) {
+        xTaskNotify(handle, rearm_bit, eSetBits);
+    }
+}
+
+latency_t get_latency(event_t event) {
+    return latencies[event];
+}
+
+event_t get_running() {
+    return running;
+}
+
+bool boost(bool on) {
+    portENTER_CRITICAL(&lock);
+    TaskHandle_t handle = task_handle;
+    const bool change   = handle != nullptr && boosted != on;
+    if(change) {
+        boosted = on;
+    }
+    portEXIT_CRITICAL(&lock);
+    if(change) {
+        vTaskPrioritySet(handle, on ? boosted_priority
+                                    : board_configs::default_task_priority);
+    }
+    return change;
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    set_handler(diagnostics, log_diagnostics);
+    post_after(diagnostics, diagnostics_period);
+
+    TaskHandle_t handle = loop_task.create(
+        task, "eventLoop", board_configs::default_task_priority, APP_CPU_NUM);
+
+    portENTER_CRITICAL(&lock);
+    task_handle          = handle;
+    const uint32_t early = early_bits;
+    early_bits           = 0;
+    portEXIT_CRITICAL(&lock);
+    if(early != 0) {
+        xTaskNotify(handle, early, eSetBits);
+    }
+}
+
+}  // namespace event_loop
@@ -0,0 +1,79 @@
+/**
+ * @file event_loop.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief one task that runs the handlers of the app, woken by task
+ * notifications
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+
+namespace event_loop {
+
+/**
+ * @brief each event is a bit of the task notification value, posting an
+ * event that is already pending coalesces with it
+ */
+enum event_t : uint8_t {
+    leds_update = 0,
+    persist,
+    scheduler_tick,
+    diagnostics,
+    touch,
+    group_persist,
+    ambient_persist,
+    num_events,
+};
+
+using handler_t = void (*)();
+
+struct latency_t {
+    uint32_t count;
+    uint32_t max_us;    // post to dispatch
+    uint32_t total_us;  // post to dispatch
+    uint32_t max_run_us;
+};
+
+/**
+ * @brief create the loop task, events posted before it runs are kept
+ */
+void init();
+
+/**
+ * @brief set the handler of an event, a single handler per event
+ */
+void set_handler(event_t event, handler_t handler);
+
+void post(event_t event);
+
+void post_from_isr(event_t event, BaseType_t *higher_priority_task_woken);
+
+/**
+ * @brief post the event once delay has passed, if it is already armed the
+ * earlier deadline stays
+ */
+void post_after(event_t event, TickType_t delay);
+
+latency_t get_latency(event_t event);
+
+/**
+ * @return the event whose handler is running, num_events between them
+ */
+event_t get_running();
+
+/**
+ * @brief run the loop just under the BLE host while on, to get ahead of a
+ * task of the same priority holding it off; back to the default when off
+ *
+ * @return false if it was already so
+ */
+bool boost(bool on);
+
+}  // namespace event_loop
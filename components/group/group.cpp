@@ -0,0 +1,254 @@
+/**
+ * @file group.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "mbedtls/md.h"
+
+#include "group.hpp"
+#include "ambient.hpp"
+#include "effects.hpp"
+#include "event_loop.hpp"
+#include "scheduler.hpp"
+#include "storage.hpp"
+
+namespace group {
+
+namespace {
+
+constexpr auto TAG         = "GROUP";
+constexpr auto *nvkey      = "group";
+constexpr auto *senders_nv = "grpseen";
+
+// the sequences seen are saved at most this long after they come, a reboot
+// only forgets the packets of the last few seconds
+constexpr TickType_t persist_delay = pdMS_TO_TICKS(5000);
+
+struct __attribute__((packed)) saved_t {
+    uint8_t group_id;
+    uint8_t key[key_size];
+    uint32_t seq_reserved;
+};
+
+struct pending_t {
+    esp_timer_handle_t timer;
+    uint8_t brightness;
+};
+
+broadcast_t broadcast_cb = nullptr;
+listen_t listen_cb       = nullptr;
+
+uint32_t own_id = 0;
+
+// changed by the BLE host and saved from the event loop, the outgoing packet
+// is refreshed by the BLE host while its burst goes on
+portMUX_TYPE lock          = portMUX_INITIALIZER_UNLOCKED;
+saved_t saved              = {};
+uint32_t next_seq          = 0;
+senders_t senders          = {};
+packet_t outgoing          = {};
+int64_t outgoing_target_us = 0;  // 0 while no burst is running
+
+pending_t pending[2] = {};
+stats_t stats        = {};
+
+void hmac(const uint8_t *data, size_t len, uint8_t *digest) {
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), saved.key,
+                    key_size, data, len, digest);
+}
+
+/**
+ * @brief from the event loop, the BLE host and the esp_timer task are no
+ * place for a commit
+ */
+void persist() {
+    portENTER_CRITICAL(&lock);
+    const saved_t saved_copy     = saved;
+    const senders_t senders_copy = senders;
+    portEXIT_CRITICAL(&lock);
+    storage::set_blob(nvkey, &saved_copy, sizeof saved_copy);
+    storage::set_blob(senders_nv, &senders_copy, sizeof senders_copy);
+}
+
+void on_apply(void *arg) {
+    const auto channel = static_cast<leds::channel_t>(
+        reinterpret_cast<uintptr_t>(arg));
+    // like a write of its own, it takes over from the automatics
+    effects::stop();
+    scheduler::cancel_ramp(channel);
+    leds::push_message({channel, pending[channel].brightness});
+    ambient::set_enabled(false);
+    ++stats.applied;
+}
+
+void schedule(leds::channel_t channel, uint8_t brightness,
+              int64_t target_us) {
+    auto &slot = pending[channel];
+    esp_timer_stop(slot.timer);
+    slot.brightness = brightness;
+    const int64_t delay_us = target_us - esp_timer_get_time();
+    esp_timer_start_once(slot.timer, delay_us > 0 ? delay_us : 1);
+}
+
+}  // namespace
+
+
+void init(broadcast_t broadcast, listen_t listen) {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    broadcast_cb = broadcast;
+    listen_cb    = listen;
+
+    size_t size = sizeof saved;
+    if(!storage::get_blob(nvkey, &saved, size) || size != sizeof saved) {
+        saved = {};
+    }
+    size = sizeof senders;
+    if(!storage::get_blob(senders_nv, &senders, size)
+       || size != sizeof senders) {
+        senders.clear();
+    }
+    // a block of its own for this boot, saved before the first send can use
+    // it; from here on the next block is saved from the event loop half a
+    // block ahead. Still on the main task, before the BLE host runs.
+    next_seq = saved.seq_reserved;
+    if(saved.group_id != 0) {
+        saved.seq_reserved = next_seq + seq_block;
+        storage::set_blob(nvkey, &saved, sizeof saved);
+    }
+
+    uint8_t mac[6];
+    ESP_ERROR_CHECK(esp_read_mac(mac, ESP_MAC_BT));
+    memcpy(&own_id, &mac[2], sizeof own_id);
+
+    for(uint8_t i = 0; i < 2; ++i) {
+        const esp_timer_create_args_t timer_args = {
+            .callback        = on_apply,
+            .arg             = reinterpret_cast<void *>(i),
+            .dispatch_method = ESP_TIMER_TASK,
+            .name            = "group",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &pending[i].timer));
+    }
+    event_loop::set_handler(event_loop::group_persist, persist);
+    ESP_LOGI(TAG, "group %u", saved.group_id);
+    listen_cb(saved.group_id != 0);
+}
+
+void join(const join_t &join) {
+    portENTER_CRITICAL(&lock);
+    saved.group_id = join.group_id;
+    memcpy(saved.key, join.key, key_size);
+    // the sequence goes on, the others may know it from the last group
+    saved.seq_reserved = next_seq + seq_block;
+    senders.clear();
+    portEXIT_CRITICAL(&lock);
+    event_loop::post(event_loop::group_persist);
+    ESP_LOGI(TAG, "joined group %u", join.group_id);
+    listen_cb(join.group_id != 0);
+}
+
+uint8_t get_group() {
+    return saved.group_id;
+}
+
+bool send(const leds::message_t &message) {
+    if(saved.group_id == 0 || !leds::is_valid(message.channel)) {
+        return false;
+    }
+
+    const int64_t target_us = esp_timer_get_time() + delay_ms * 1000;
+    portENTER_CRITICAL(&lock);
+    outgoing.company    = company_id;
+    outgoing.version    = version;
+    outgoing.group_id   = saved.group_id;
+    outgoing.sender     = own_id;
+    outgoing.seq        = next_seq++;
+    outgoing.channel    = message.channel;
+    outgoing.brightness = message.brightness;
+    outgoing_target_us  = target_us;
+    const bool reserve  = next_seq + seq_block / 2 >= saved.seq_reserved;
+    if(reserve) {
+        saved.seq_reserved += seq_block;
+    }
+    portEXIT_CRITICAL(&lock);
+    if(reserve) {
+        event_loop::post(event_loop::group_persist);
+    }
+
+    schedule(message.channel, message.brightness, target_us);
+    ++stats.sent;
+    broadcast_cb();
+    return true;
+}
+
+size_t payload(uint8_t *out) {
+    portENTER_CRITICAL(&lock);
+    const int64_t left_us = outgoing_target_us - esp_timer_get_time();
+    packet_t packet       = outgoing;
+    if(outgoing_target_us != 0 && left_us <= 0) {
+        outgoing_target_us = 0;
+    }
+    const bool running = outgoing_target_us != 0;
+    portEXIT_CRITICAL(&lock);
+    if(!running) {
+        return 0;
+    }
+
+    packet.countdown_ms = countdown_of(left_us);
+    sign(packet, hmac);
+    memcpy(out, &packet, sizeof packet);
+    return sizeof packet;
+}
+
+void receive(const uint8_t *data, size_t len) {
+    // some other manufacturer data most of the time
+    packet_t packet;
+    if(saved.group_id == 0 || len != sizeof packet) {
+        return;
+    }
+    memcpy(&packet, data, sizeof packet);
+    if(!addressed_to(packet, saved.group_id, own_id)) {
+        return;
+    }
+    const int64_t now_us = esp_timer_get_time();
+    if(!verify(packet, hmac)) {
+        ++stats.bad_mac;
+        return;
+    }
+
+    portENTER_CRITICAL(&lock);
+    const bool taken = senders.take(packet.sender, packet.seq, stats);
+    portEXIT_CRITICAL(&lock);
+    if(!taken) {
+        return;
+    }
+    event_loop::post_after(event_loop::group_persist, persist_delay);
+
+    if(!applicable(packet)) {
+        return;
+    }
+    schedule(static_cast<leds::channel_t>(packet.channel), packet.brightness,
+             now_us + packet.countdown_ms * 1000);
+}
+
+stats_t get_stats() {
+    return stats;
+}
+
+}  // namespace group
@@ -0,0 +1,80 @@
+/**
+ * @file group.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief mirrors in the same room following one brightness write together
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The device that gets the write advertises a signed packet_t as
+ * manufacturer data for delay_ms, the others scan for it. Legacy advertising
+ * carries no time base, so the packet holds the time left until everyone
+ * applies it, refreshed while the burst goes on.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "leds.hpp"
+#include "packet.hpp"
+
+namespace group {
+
+/**
+ * @brief written over BLE, group 0 leaves the group
+ */
+struct __attribute__((packed)) join_t {
+    uint8_t group_id;
+    uint8_t key[key_size];
+};
+
+/**
+ * @brief start advertising a burst, its data comes from payload() until it
+ * returns 0
+ */
+using broadcast_t = void (*)();
+
+/**
+ * @brief start or stop scanning for the packets of the group
+ */
+using listen_t = void (*)(bool on);
+
+void init(broadcast_t broadcast, listen_t listen);
+
+void join(const join_t &join);
+
+/**
+ * @return 0 while in no group
+ */
+uint8_t get_group();
+
+/**
+ * @brief apply the message together with the group
+ *
+ * @return false while in no group, the caller applies it alone, or for a
+ * channel that does not exist
+ */
+bool send(const leds::message_t &message);
+
+/**
+ * @brief the packet of the burst running, with the countdown of now
+ *
+ * @param out at least sizeof(packet_t)
+ * @return 0 once the burst is over
+ */
+size_t payload(uint8_t *out);
+
+/**
+ * @brief manufacturer data from an advertisement, anything that is not a
+ * packet of our group is ignored
+ *
+ * The sequence is checked against the sender in the packet, under the MAC,
+ * not the advertiser address anyone can take.
+ */
+void receive(const uint8_t *data, size_t len);
+
+stats_t get_stats();
+
+}  // namespace group
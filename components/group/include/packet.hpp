@@ -0,0 +1,167 @@
+/**
+ * @file packet.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the group packet, its MAC and the sequence check of the senders,
+ * no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "leds.hpp"
+
+namespace group {
+
+// none is assigned to us, 0xffff is the one for tests and internal use
+constexpr uint16_t company_id = 0xffff;
+constexpr uint8_t version     = 2;
+constexpr uint8_t key_size    = 16;
+constexpr uint8_t mac_size    = 8;
+// from the write to the whole group applying it, the burst lasts as long
+constexpr uint32_t delay_ms = 200;
+// a sender saves its sequence once per block, a reboot skips to the next one
+constexpr uint32_t seq_block  = 1024;
+constexpr uint8_t max_senders = 4;
+
+struct __attribute__((packed)) packet_t {
+    uint16_t company;
+    uint8_t version;
+    uint8_t group_id;
+    uint32_t sender;  // the low bytes of the Bluetooth MAC of the sender
+    uint32_t seq;     // per sender, never reused
+    uint8_t channel;
+    uint8_t brightness;
+    uint16_t countdown_ms;  // left until applying, as of this advertisement
+    uint8_t mac[mac_size];  // HMAC-SHA256 of the fields above, truncated
+};
+
+// 31 bytes of advertising data, less the flags and the field header
+static_assert(sizeof(packet_t) <= 31 - 3 - 2, "packet_t is too big");
+
+constexpr size_t signed_size = offsetof(packet_t, mac);
+
+struct stats_t {
+    uint32_t sent;
+    uint32_t received;  // accepted commands, repeats of a burst not counted
+    uint32_t applied;
+    uint32_t bad_mac;
+    uint32_t replayed;
+    uint32_t missed;  // gaps in the sequence of a sender
+};
+
+/**
+ * @brief the countdown of a packet advertised left_us before the target,
+ * saturated to what the field holds
+ */
+constexpr uint16_t countdown_of(int64_t left_us) {
+    return left_us <= 0              ? 0
+           : left_us / 1000 > 0xffff ? 0xffff
+                                     : static_cast<uint16_t>(left_us / 1000);
+}
+
+/**
+ * @param hmac called as hmac(data, len, digest) for a 32 byte digest with
+ * the key of the group
+ */
+template <typename hmac_t>
+void sign(packet_t &packet, hmac_t hmac) {
+    uint8_t digest[32];
+    hmac(reinterpret_cast<const uint8_t *>(&packet), signed_size, digest);
+    memcpy(packet.mac, digest, mac_size);
+}
+
+template <typename hmac_t>
+bool verify(const packet_t &packet, hmac_t hmac) {
+    packet_t expected = packet;
+    sign(expected, hmac);
+    // the same time whatever byte differs
+    uint8_t diff = 0;
+    for(uint8_t i = 0; i < mac_size; ++i) {
+        diff |= expected.mac[i] ^ packet.mac[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief a packet of the group from another mirror, the MAC still to check
+ */
+inline bool addressed_to(const packet_t &packet, uint8_t group_id,
+                         uint32_t own_id) {
+    return packet.company == company_id && packet.version == version
+           && packet.group_id == group_id && packet.sender != own_id;
+}
+
+/**
+ * @brief a command the LEDs can take, checked only once the MAC is
+ */
+inline bool applicable(const packet_t &packet) {
+    return leds::is_valid(static_cast<leds::channel_t>(packet.channel))
+           && packet.brightness <= 100;
+}
+
+/**
+ * @brief the last sequence of the latest senders, saved as it is
+ */
+class senders_t {
+public:
+    /**
+     * @return false for a repeat within the burst or a replay
+     */
+    bool take(uint32_t id, uint32_t seq, stats_t &stats) {
+        auto &sender = find(id);
+        if(sender.used) {
+            // the same packet comes many times in a burst
+            if(seq == sender.seq) {
+                return false;
+            }
+            if(seq < sender.seq) {
+                ++stats.replayed;
+                return false;
+            }
+            // a bigger jump is the sender rebooting into its next block
+            const uint32_t gap = seq - sender.seq - 1;
+            if(gap < seq_block) {
+                stats.missed += gap;
+            }
+        }
+        sender.used = true;
+        sender.seq  = seq;
+        ++stats.received;
+        return true;
+    }
+
+    void clear() {
+        *this = {};
+    }
+
+private:
+    struct sender_t {
+        bool used;
+        uint32_t id;
+        uint32_t seq;
+    };
+
+    sender_t &find(uint32_t id) {
+        for(auto &sender : m_senders) {
+            if(sender.used && sender.id == id) {
+                return sender;
+            }
+        }
+        auto &sender = m_senders[m_next_evict];
+        m_next_evict = (m_next_evict + 1) % max_senders;
+        sender       = {false, id, 0};
+        return sender;
+    }
+
+    sender_t m_senders[max_senders] = {};
+    uint8_t m_next_evict            = 0;
+};
+
+}  // namespace group
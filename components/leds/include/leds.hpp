@@ -10,6 +10,30 @@ enum channel_t : uint8_t {
     channel1 = ledc_channel_t::LEDC_CHANNEL_1,
 };
 
+/**
+ * @brief full scale of write_level, 1 << level_bits is 100%
+ */
+constexpr uint8_t level_bits = 15;
+constexpr uint16_t max_level = 1U << level_bits;
+
+/**
+ * @brief PWM frequency and resolution, each runs on a LEDC timer of its own
+ * so switching only binds the channels to another timer
+ */
+enum profile_t : uint8_t {
+    profile_standard = 0,  // 20 kHz, 11 bit
+    profile_smooth,        // 2 kHz, 15 bit, for drivers that like it slow
+    profile_camera,        // 39 kHz, 10 bit, no banding on video
+    num_profiles,
+};
+
+/**
+ * @brief a channel read from outside, BLE or the storage, may be anything
+ */
+constexpr bool is_valid(channel_t channel) {
+    return channel == channel0 || channel == channel1;
+}
+
 struct message_t {
     channel_t channel;
     uint8_t brightness;
@@ -31,4 +55,96 @@ void init();
 
 void push_message(const message_t &message);
 
+/**
+ * @brief apply the queued messages now instead of on the next leds_update,
+ * only from the event loop task
+ */
+void flush();
+
+/**
+ * @brief write the duty of a channel right away, bypassing the message queue,
+ * from any task after init()
+ *
+ * @param channel
+ * @param level [0-max_level]
+ */
+void write_level(channel_t channel, uint16_t level);
+
+/**
+ * @brief the brightness [0-100] last applied to the channel
+ */
+uint8_t get_brightness(channel_t channel);
+
+/**
+ * @brief move the channels in the mask to a profile, the choice is saved
+ * with the brightness a minute later
+ *
+ * @param channel_mask bit n is channel n
+ * @return false for an unknown profile
+ */
+bool set_profile(uint8_t channel_mask, profile_t profile);
+
+profile_t get_profile(channel_t channel);
+
+/**
+ * @brief called from the event loop once the brightness is in the storage
+ */
+using persist_hook_t = void (*)();
+
+void set_persist_hook(persist_hook_t hook);
+
+/**
+ * @brief apply latency histogram, bucket i counts [2^(i-1), 2^i) us
+ */
+constexpr uint8_t latency_buckets = 24;
+
+struct stats_t {
+    uint32_t pushed;
+    uint32_t applied;
+    // dropped from a full queue in favour of the newest message
+    uint32_t coalesced;
+    uint32_t max_depth;
+    // behind by more than 100 ms and overwritten by a newer one anyway
+    uint32_t stale;
+    uint32_t latency[latency_buckets];
+};
+
+/**
+ * @brief counters of the push_message -> apply pipeline since boot
+ */
+stats_t get_stats();
+
+enum stage_t : uint8_t {
+    stage_idle = 0,  // nothing waiting
+    stage_queued,    // pushed, the event loop has not got to it yet
+    stage_applying,  // the event loop is writing the queue to the LEDC
+};
+
+struct pipeline_t {
+    stage_t stage;
+    // when the oldest message still waiting was pushed, 0 while idle
+    int64_t since_us;
+};
+
+/**
+ * @brief where the pipeline stands, safe from any task
+ */
+pipeline_t get_pipeline();
+
+/**
+ * @brief called from the task pushing when its message finds the pipeline
+ * idle, it only leaves queued and applying through idle again
+ */
+using queued_hook_t = void (*)();
+
+void set_queued_hook(queued_hook_t hook);
+
+/**
+ * @brief upper bound in us of the bucket holding the percentile
+ *
+ * @param stats
+ * @param percent [0-100]
+ */
+uint32_t latency_percentile(const stats_t &stats, uint8_t percent);
+
 }  // namespace leds
\ No newline at end of file
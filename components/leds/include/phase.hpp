@@ -0,0 +1,82 @@
+/**
+ * @file phase.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief spreading the PWM pulses of the channels over the period, no IDF in
+ * here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace leds {
+
+/**
+ * @brief the hpoints packing the pulses one after the other, so they overlap
+ * only once they add up to more than the period
+ *
+ * A pulse never wraps around the end of the period, the LEDC does not
+ * support it, the ones that do not fit are pulled back against the end.
+ * For two channels that is the least overlap there can be.
+ *
+ * @param pulse [0-period] high time of each channel, in timer counts
+ * @param hpoint where each pulse starts
+ */
+inline void stagger(const uint32_t *pulse, uint32_t *hpoint, size_t count,
+                    uint32_t period) {
+    uint32_t next = 0;
+    for(size_t i = 0; i < count; ++i) {
+        // the timer counts up to period - 1, an hpoint past it never fires
+        uint32_t latest = pulse[i] > 0 ? period - pulse[i] : period - 1;
+        hpoint[i]       = next < latest ? next : latest;
+        next            = hpoint[i] + pulse[i];
+    }
+}
+
+/**
+ * @brief a span of the period, it wraps around the end if
+ * start + length > period
+ */
+struct interval_t {
+    uint32_t start;
+    uint32_t length;
+};
+
+constexpr bool contains(const interval_t &interval, uint32_t point,
+                        uint32_t period) {
+    return (point + period - interval.start) % period < interval.length;
+}
+
+/**
+ * @brief the highest sum of the currents of the channels on at the same
+ * time, it is reached where one of them turns on
+ *
+ * @param on when each channel is lit
+ * @param current drawn by each channel while lit
+ */
+inline uint32_t peak_current(const interval_t *on, const uint32_t *current,
+                             size_t count, uint32_t period) {
+    uint32_t peak = 0;
+    for(size_t i = 0; i < count; ++i) {
+        if(on[i].length == 0) {
+            continue;
+        }
+        uint32_t sum = 0;
+        for(size_t j = 0; j < count; ++j) {
+            if(contains(on[j], on[i].start % period, period)) {
+                sum += current[j];
+            }
+        }
+        if(sum > peak) {
+            peak = sum;
+        }
+    }
+    return peak;
+}
+
+}  // namespace leds
@@ -9,14 +9,21 @@
  *
  */
 
+#include <atomic>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
-#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "leds.hpp"
+#include "phase.hpp"
 #include "board_configs.hpp"
+#include "event_loop.hpp"
+#include "static_alloc.hpp"
 #include "storage.hpp"
+#include "trace.hpp"
 
 namespace leds {
 
@@ -25,9 +32,7 @@ namespace {
 constexpr TickType_t minute_in_ticks = pdMS_TO_TICKS(1000 * 60);
 
 constexpr auto TAG = "LEDS";
-constexpr ledc_timer_bit_t pwm_duty_resolution
-    = ledc_timer_bit_t::LEDC_TIMER_11_BIT;
-constexpr uint32_t pwm_frequency = 20e3;
+constexpr auto *nvkey = "pwm";
 
 uint8_t curr_bris[2] = {0};
 void set_current_brightness(message_t message) {
@@ -39,47 +44,262 @@ void set_current_brightness(message_t message) {
     }
 }
 
+struct pwm_profile_t {
+    ledc_timer_t timer;
+    uint32_t frequency;
+    ledc_timer_bit_t resolution;
+    // from write_level's scale to the timer's, fixed per profile
+    uint8_t shift;
+    uint32_t max_duty;
+};
+
+constexpr pwm_profile_t make_profile(ledc_timer_t timer, uint32_t frequency,
+                                     ledc_timer_bit_t resolution) {
+    return {timer, frequency, resolution,
+            static_cast<uint8_t>(level_bits - resolution), 1U << resolution};
+}
+
+// frequency << resolution has to stay under the 80 MHz APB clock
+constexpr pwm_profile_t profiles[num_profiles] = {
+    make_profile(LEDC_TIMER_0, 20000, LEDC_TIMER_11_BIT),
+    make_profile(LEDC_TIMER_1, 2000, LEDC_TIMER_15_BIT),
+    make_profile(LEDC_TIMER_2, 39000, LEDC_TIMER_10_BIT),
+};
+
+constexpr bool profiles_fit() {
+    for(const auto &profile : profiles) {
+        if(profile.resolution > level_bits
+           || (profile.frequency << profile.resolution) > 80000000) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(profiles_fit(), "a profile is finer than level_bits or APB");
+
+// set over BLE, bound to the channels and saved by the event loop
+std::atomic<profile_t> requested[2] = {{profile_standard},
+                                       {profile_standard}};
+std::atomic<bool> profiles_changed{false};
+const pwm_profile_t *active[2] = {&profiles[0], &profiles[0]};
+uint16_t levels[2]             = {0};
+
+// high time and start of the pulse of each channel, in timer counts
+uint32_t pulses[2]  = {0};
+uint32_t hpoints[2] = {0};
+
+// a write restaggers both channels, and comes from the event loop as well as
+// from the effects frames on the esp_timer task
+static_alloc::mutex_t ledc_mutex_buffer;
+SemaphoreHandle_t ledc_mutex = nullptr;
+
+/**
+ * @brief the caller holds ledc_mutex
+ */
+void write_duty(channel_t channel, uint32_t on_duty) {
+    const auto *profile = active[channel];
+    // the LEDs are on while the output is low, so packing the high pulses one
+    // after the other keeps the lit spans of the channels apart as well, it
+    // takes both channels counting on the same timer
+    pulses[channel] = profile->max_duty - on_duty;
+    uint32_t next[2] = {0};
+    if(active[0] == active[1]) {
+        stagger(pulses, next, 2, profile->max_duty);
+    }
+    for(uint8_t i = 0; i < 2; ++i) {
+        if(i != channel && next[i] == hpoints[i]) {
+            continue;
+        }
+        hpoints[i]              = next[i];
+        const auto ledc_channel = static_cast<ledc_channel_t>(i);
+        ledc_set_duty_with_hpoint(ledc_mode_t::LEDC_HIGH_SPEED_MODE,
+                                  ledc_channel, pulses[i], hpoints[i]);
+        ledc_update_duty(ledc_mode_t::LEDC_HIGH_SPEED_MODE, ledc_channel);
+    }
+    trace::record(trace::leds_apply, channel, on_duty << profile->shift);
+}
+
+/**
+ * @brief the caller holds ledc_mutex
+ */
+void set_level(channel_t channel, uint16_t level) {
+    if(level > max_level) {
+        level = max_level;
+    }
+    levels[channel] = level;
+    write_duty(channel, level >> active[channel]->shift);
+}
+
 void m_set_brightness(channel_t channel, uint8_t brightness) {
     // XXX I can receive directly the full range [0-2047]
     constexpr uint8_t max_bri_input = 100;
     if(brightness > 100) {
         brightness = max_bri_input;
     }
-    brightness = max_bri_input - brightness;
-    // max_bri == 2048
-    constexpr auto max_bri = 1U << pwm_duty_resolution;
-    uint32_t duty          = brightness * static_cast<double>(max_bri)
-                    / static_cast<double>(max_bri_input);
-    // channel0 == IN_LEDS
-    if(channel == channel_t::channel0) {
-        ledc_set_duty(ledc_mode_t::LEDC_HIGH_SPEED_MODE,
-                      ledc_channel_t::LEDC_CHANNEL_0, duty);
-        ledc_update_duty(ledc_mode_t::LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0);
-    }
-    // channel1 == OUT_LEDS
-    else {
-        ledc_set_duty(ledc_mode_t::LEDC_HIGH_SPEED_MODE,
-                      ledc_channel_t::LEDC_CHANNEL_1, duty);
-        ledc_update_duty(ledc_mode_t::LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_1);
+    write_level(channel, brightness * max_level / max_bri_input);
+}
+
+struct queued_t {
+    message_t message;
+    int64_t enqueued_us;
+};
+
+constexpr UBaseType_t queue_length = 10;
+// a message this old is dropped if a newer one for its channel is queued
+constexpr int64_t stale_us = 100 * 1000;
+
+// created in init(), not during static initialization before app_main
+static_alloc::queue_t<queued_t, queue_length> brightness_queue;
+QueueHandle_t q_brightness = nullptr;
+
+// pushed from the BLE host, effects and the event loop concurrently, every
+// counter is only ever updated with the __atomic builtins
+stats_t stats = {};
+
+persist_hook_t persist_hook = nullptr;
+queued_hook_t queued_hook   = nullptr;
+
+// read by the watchdog from the esp_timer task
+portMUX_TYPE pipeline_lock = portMUX_INITIALIZER_UNLOCKED;
+pipeline_t pipeline        = {stage_idle, 0};
+
+void enter_applying() {
+    portENTER_CRITICAL(&pipeline_lock);
+    pipeline.stage = stage_applying;
+    portEXIT_CRITICAL(&pipeline_lock);
+}
+
+/**
+ * @brief idle to queued, the watchdog is told to start checking
+ */
+void mark_queued(int64_t since_us) {
+    portENTER_CRITICAL(&pipeline_lock);
+    const bool was_idle = pipeline.stage == stage_idle;
+    if(was_idle) {
+        pipeline = {stage_queued, since_us};
+    }
+    portEXIT_CRITICAL(&pipeline_lock);
+    if(was_idle && queued_hook != nullptr) {
+        queued_hook();
+    }
+}
+
+/**
+ * @brief idle if the queue is empty, anything pushed while applying keeps
+ * the time the oldest of it was pushed
+ */
+void leave_applying() {
+    queued_t oldest;
+    const bool waiting = xQueuePeek(q_brightness, &oldest, 0) == pdTRUE;
+    portENTER_CRITICAL(&pipeline_lock);
+    pipeline = waiting ? pipeline_t{stage_queued, oldest.enqueued_us}
+                       : pipeline_t{stage_idle, 0};
+    portEXIT_CRITICAL(&pipeline_lock);
+    // a push between the peek and the lock found the pipeline applying and
+    // left it to us
+    if(!waiting && xQueuePeek(q_brightness, &oldest, 0) == pdTRUE) {
+        mark_queued(oldest.enqueued_us);
     }
 }
 
-const QueueHandle_t q_brightness = xQueueCreate(sizeof(message_t), 10);
-void task(void* ignore) {
-    while(true) {
-        message_t message;
-        xQueueReceive(q_brightness, &message, portMAX_DELAY);
+bool superseded(const queued_t *items, size_t index, size_t count) {
+    for(size_t i = index + 1; i < count; ++i) {
+        if(items[i].message.channel == items[index].message.channel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void record_latency(int64_t latency_us) {
+    uint8_t bucket = 0;
+    if(latency_us > 0) {
+        bucket = 64 - __builtin_clzll(latency_us);
+    }
+    if(bucket >= latency_buckets) {
+        bucket = latency_buckets - 1;
+    }
+    __atomic_fetch_add(&stats.latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+void apply_profiles() {
+    xSemaphoreTake(ledc_mutex, portMAX_DELAY);
+    bool changed = false;
+    for(uint8_t i = 0; i < 2; ++i) {
+        const auto *profile = &profiles[requested[i].load()];
+        if(profile == active[i]) {
+            continue;
+        }
+        active[i] = profile;
+        ledc_bind_channel_timer(ledc_mode_t::LEDC_HIGH_SPEED_MODE,
+                                static_cast<ledc_channel_t>(i), profile->timer);
+        ESP_LOGI(TAG, "ch: %u, %u Hz, %u bit", i, profile->frequency,
+                 profile->resolution);
+        changed = true;
+    }
+    // the same levels, rescaled to the new resolutions
+    if(changed) {
+        set_level(channel0, levels[0]);
+        set_level(channel1, levels[1]);
+    }
+    xSemaphoreGive(ledc_mutex);
+}
+
+void apply_messages() {
+    enter_applying();
+    apply_profiles();
+    queued_t items[queue_length];
+    size_t count = 0;
+    while(count < queue_length
+          && xQueueReceive(q_brightness, &items[count], 0) == pdTRUE) {
+        ++count;
+    }
+
+    bool changed = false;
+    for(size_t i = 0; i < count; ++i) {
+        const auto &message = items[i].message;
+        const int64_t age   = esp_timer_get_time() - items[i].enqueued_us;
+        // behind already, no point in showing a value that is overwritten
+        if(age > stale_us && superseded(items, i, count)) {
+            __atomic_fetch_add(&stats.stale, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        record_latency(age);
+        __atomic_fetch_add(&stats.applied, 1, __ATOMIC_RELAXED);
         set_current_brightness(message);
-        ESP_LOGI(TAG, "ch: %u, bri: %03u", message.channel, message.brightness);
         m_set_brightness(message.channel, message.brightness);
+        changed = true;
+    }
+    // saved a minute after the first change, nothing wakes up while idle
+    if(changed) {
+        event_loop::post_after(event_loop::persist, minute_in_ticks);
     }
+    leave_applying();
 }
 
-void task_save_values(void* ignore) {
-    while(true) {
-        vTaskDelay(minute_in_ticks);
-        ESP_LOGI(TAG, "saving current brightness to NVS.");
-        storage::set_values(curr_bris);
+void save_values() {
+    ESP_LOGI(TAG, "saving current brightness to NVS.");
+    trace::record(trace::persist, channel0, curr_bris[0]);
+    trace::record(trace::persist, channel1, curr_bris[1]);
+    storage::set_values(curr_bris);
+    if(profiles_changed.exchange(false)) {
+        const uint8_t saved[2] = {requested[0], requested[1]};
+        storage::set_blob(nvkey, saved, sizeof saved);
+    }
+    if(persist_hook != nullptr) {
+        persist_hook();
+    }
+}
+
+void get_saved_profiles() {
+    uint8_t saved[2] = {0};
+    size_t size      = sizeof saved;
+    storage::get_blob(nvkey, saved, size);
+    for(uint8_t i = 0; i < 2; ++i) {
+        if(saved[i] < num_profiles) {
+            requested[i] = static_cast<profile_t>(saved[i]);
+            active[i]    = &profiles[saved[i]];
+        }
     }
 }
 
@@ -103,12 +323,101 @@ void get_saved_values() {
 
 
 void push_message(const message_t& message) {
-    auto ret = xQueueSend(q_brightness, &message, 0);
+    if(!is_valid(message.channel)) {
+        return;
+    }
+    const queued_t item = {message, esp_timer_get_time()};
+    __atomic_fetch_add(&stats.pushed, 1, __ATOMIC_RELAXED);
+    auto ret = xQueueSend(q_brightness, &item, 0);
     if(ret == errQUEUE_FULL) {
-        message_t rxbuf;
+        queued_t rxbuf;
         xQueueReceive(q_brightness, &rxbuf, 0);
-        xQueueSend(q_brightness, &message, 0);
+        xQueueSend(q_brightness, &item, 0);
+        __atomic_fetch_add(&stats.coalesced, 1, __ATOMIC_RELAXED);
     }
+    mark_queued(item.enqueued_us);
+    const uint32_t depth = uxQueueMessagesWaiting(q_brightness);
+    uint32_t max_depth   = __atomic_load_n(&stats.max_depth, __ATOMIC_RELAXED);
+    while(depth > max_depth
+          && !__atomic_compare_exchange_n(&stats.max_depth, &max_depth, depth,
+                                          true, __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED)) {
+    }
+    event_loop::post(event_loop::leds_update);
+}
+
+void flush() {
+    apply_messages();
+}
+
+pipeline_t get_pipeline() {
+    portENTER_CRITICAL(&pipeline_lock);
+    const pipeline_t current = pipeline;
+    portEXIT_CRITICAL(&pipeline_lock);
+    return current;
+}
+
+void write_level(channel_t channel, uint16_t level) {
+    // the arrays behind it only hold the two channels
+    if(!is_valid(channel)) {
+        return;
+    }
+    xSemaphoreTake(ledc_mutex, portMAX_DELAY);
+    set_level(channel, level);
+    xSemaphoreGive(ledc_mutex);
+}
+
+uint8_t get_brightness(channel_t channel) {
+    return channel == channel_t::channel0 ? curr_bris[0] : curr_bris[1];
+}
+
+stats_t get_stats() {
+    return stats;
+}
+
+bool set_profile(uint8_t channel_mask, profile_t profile) {
+    if(profile >= num_profiles) {
+        return false;
+    }
+    for(uint8_t i = 0; i < 2; ++i) {
+        if(channel_mask & (1U << i)) {
+            requested[i] = profile;
+        }
+    }
+    // the NVS commit is left to the event loop, not the BLE host
+    profiles_changed = true;
+    event_loop::post(event_loop::leds_update);
+    event_loop::post_after(event_loop::persist, minute_in_ticks);
+    return true;
+}
+
+void set_persist_hook(persist_hook_t hook) {
+    persist_hook = hook;
+}
+
+void set_queued_hook(queued_hook_t hook) {
+    queued_hook = hook;
+}
+
+profile_t get_profile(channel_t channel) {
+    return is_valid(channel) ? requested[channel].load() : profile_standard;
+}
+
+uint32_t latency_percentile(const stats_t& stats, uint8_t percent) {
+    uint32_t total = 0;
+    for(auto count : stats.latency) {
+        total += count;
+    }
+    // the sample at the percentile's rank, counting from 1
+    const uint64_t rank = (static_cast<uint64_t>(total) * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(uint8_t i = 0; i < latency_buckets; ++i) {
+        seen += stats.latency[i];
+        if(seen >= rank && seen > 0) {
+            return 1U << i;
+        }
+    }
+    return 0;
 }
 
 
@@ -119,12 +428,14 @@ void init() {
     }
     initialized = true;
 
+    get_saved_profiles();
+
     ledc_channel_config_t chan0_conf = {
         .gpio_num   = board_configs::GPIO_LED_IN,
         .speed_mode = ledc_mode_t::LEDC_HIGH_SPEED_MODE,
         .channel    = ledc_channel_t::LEDC_CHANNEL_0,
         .intr_type  = ledc_intr_type_t::LEDC_INTR_DISABLE,
-        .timer_sel  = ledc_timer_t::LEDC_TIMER_0,
+        .timer_sel  = active[0]->timer,
         .duty       = 0,
         .hpoint     = 0,
     };
@@ -134,28 +445,29 @@ void init() {
         .speed_mode = ledc_mode_t::LEDC_HIGH_SPEED_MODE,
         .channel    = ledc_channel_t::LEDC_CHANNEL_1,
         .intr_type  = ledc_intr_type_t::LEDC_INTR_DISABLE,
-        .timer_sel  = ledc_timer_t::LEDC_TIMER_0,
+        .timer_sel  = active[1]->timer,
         .duty       = 0,
         .hpoint     = 0,
     };
 
-    ledc_timer_config_t timer_conf = {
-        .speed_mode      = ledc_mode_t::LEDC_HIGH_SPEED_MODE,
-        .duty_resolution = pwm_duty_resolution,
-        .timer_num       = ledc_timer_t::LEDC_TIMER_0,
-        .freq_hz         = pwm_frequency,
-        .clk_cfg         = ledc_clk_cfg_t::LEDC_AUTO_CLK,
-    };
+    q_brightness = brightness_queue.create("brightness");
+    ledc_mutex   = ledc_mutex_buffer.create("ledc");
 
-    ledc_timer_config(&timer_conf);
+    // every profile keeps its timer running, a switch is only a rebind
+    for(const auto &profile : profiles) {
+        ledc_timer_config_t timer_conf = {
+            .speed_mode      = ledc_mode_t::LEDC_HIGH_SPEED_MODE,
+            .duty_resolution = profile.resolution,
+            .timer_num       = profile.timer,
+            .freq_hz         = profile.frequency,
+            .clk_cfg         = ledc_clk_cfg_t::LEDC_AUTO_CLK,
+        };
+        ledc_timer_config(&timer_conf);
+    }
     ledc_channel_config(&chan0_conf);
     ledc_channel_config(&chan1_conf);
-    xTaskCreatePinnedToCore(task, "ledsTask", configMINIMAL_STACK_SIZE * 3,
-                            nullptr, board_configs::default_task_priority,
-                            nullptr, APP_CPU_NUM);
-    xTaskCreatePinnedToCore(
-        task_save_values, "saveValues", configMINIMAL_STACK_SIZE * 2, nullptr,
-        board_configs::default_task_priority, nullptr, APP_CPU_NUM);
+    event_loop::set_handler(event_loop::leds_update, apply_messages);
+    event_loop::set_handler(event_loop::persist, save_values);
 
     get_saved_values();
 }
@@ -0,0 +1,21 @@
+/**
+ * @file loadgen.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief synthetic phones writing brightness over the GATT handlers, for
+ * bench builds with CONFIG_APP_LOADGEN
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+namespace loadgen {
+
+/**
+ * @brief start a single run, it logs its report when done
+ */
+void init();
+
+}  // namespace loadgen
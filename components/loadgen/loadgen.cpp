@@ -0,0 +1,329 @@
+/**
+ * @file loadgen.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "sdkconfig.h"
+
+#if CONFIG_APP_LOADGEN
+
+#include <initializer_list>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "nimble/nimble_npl.h"
+#include "nimble/nimble_port.h"
+
+#include "loadgen.hpp"
+#include "ble_server.h"
+#include "leds.hpp"
+#include "static_alloc.hpp"
+
+namespace loadgen {
+
+namespace {
+
+constexpr auto TAG = "LOADGEN";
+
+constexpr uint8_t phones          = CONFIG_APP_LOADGEN_PHONES;
+constexpr int64_t write_period_us = 1000000 / CONFIG_APP_LOADGEN_WRITE_HZ;
+constexpr int64_t churn_us        = CONFIG_APP_LOADGEN_CHURN_MS * 1000LL;
+constexpr int64_t mtu_us          = CONFIG_APP_LOADGEN_MTU_MS * 1000LL;
+constexpr int64_t read_us         = CONFIG_APP_LOADGEN_READ_MS * 1000LL;
+constexpr int64_t duration_us     = CONFIG_APP_LOADGEN_DURATION_S * 1000000LL;
+// time a disconnected phone takes to come back
+constexpr int64_t reconnect_us = 200 * 1000;
+constexpr uint16_t max_mtu     = 247;
+// leaves the host time to sync before the first event
+constexpr TickType_t start_delay = pdMS_TO_TICKS(2000);
+
+// well above the handles NimBLE hands out
+constexpr uint16_t first_conn_handle = 0x100;
+
+/**
+ * @brief this task only keeps the schedule, what a phone does runs on the
+ * NimBLE host task as an event on its queue, like a real write does
+ */
+struct phone_t {
+    uint16_t conn_handle;
+    ble_addr_t addr;
+    bool connected;
+    int64_t next_write_us;
+    int64_t next_churn_us;
+    int64_t next_mtu_us;
+    int64_t next_read_us;
+
+    // host task only
+    uint16_t mtu;
+
+    ble_npl_event connect_event;
+    ble_npl_event disconnect_event;
+    ble_npl_event mtu_event;
+    ble_npl_event write_event;
+    ble_npl_event read_event;
+};
+
+struct counters_t {
+    uint32_t writes;
+    uint32_t rejected;
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t mtu_changes;
+    uint32_t reads;
+    uint32_t failed_reads;
+    // a read that filled the MTU, the client would follow it with a blob
+    uint32_t long_reads;
+};
+
+static_alloc::task_t<configMINIMAL_STACK_SIZE * 3> loadgen_task;
+phone_t phone_list[phones] = {};
+// written by the host task
+counters_t counters = {};
+// written by this task, an event still queued from the last time
+uint32_t behind = 0;
+
+/**
+ * @brief uniformly spread in [mean / 2, mean * 3 / 2), so the phones drift
+ * apart instead of writing in lockstep
+ */
+int64_t jittered(int64_t mean) {
+    return mean / 2 + esp_random() % static_cast<uint32_t>(mean);
+}
+
+phone_t &phone_of(ble_npl_event *ev) {
+    return *static_cast<phone_t *>(ble_npl_event_get_arg(ev));
+}
+
+void on_connect(ble_npl_event *ev) {
+    auto &phone                = phone_of(ev);
+    struct ble_gap_event event = {};
+    event.type                 = BLE_GAP_EVENT_CONNECT;
+    event.connect.status       = 0;
+    event.connect.conn_handle  = phone.conn_handle;
+    ble_inject_gap_event(&event);
+    phone.mtu = BLE_ATT_MTU_DFLT;
+    ++counters.connects;
+}
+
+void on_disconnect(ble_npl_event *ev) {
+    auto &phone                = phone_of(ev);
+    struct ble_gap_event event = {};
+    event.type                 = BLE_GAP_EVENT_DISCONNECT;
+    event.disconnect.reason
+        = BLE_HS_ERR_HCI_BASE + BLE_ERR_REM_USER_CONN_TERM;
+    event.disconnect.conn.conn_handle   = phone.conn_handle;
+    event.disconnect.conn.peer_ota_addr = phone.addr;
+    event.disconnect.conn.peer_id_addr  = phone.addr;
+    ble_inject_gap_event(&event);
+    ++counters.disconnects;
+}
+
+void on_mtu(ble_npl_event *ev) {
+    auto &phone                = phone_of(ev);
+    struct ble_gap_event event = {};
+    event.type                 = BLE_GAP_EVENT_MTU;
+    event.mtu.conn_handle      = phone.conn_handle;
+    event.mtu.channel_id       = BLE_L2CAP_CID_ATT;
+    event.mtu.value            = BLE_ATT_MTU_DFLT
+                      + esp_random() % (max_mtu - BLE_ATT_MTU_DFLT + 1);
+    ble_inject_gap_event(&event);
+    phone.mtu = event.mtu.value;
+    ++counters.mtu_changes;
+}
+
+void on_write(ble_npl_event *ev) {
+    auto &phone                   = phone_of(ev);
+    const leds::message_t message = {
+        static_cast<leds::channel_t>(esp_random() % 2),
+        static_cast<uint8_t>(esp_random() % 101),
+    };
+    if(gatt_svr_inject_write(phone.conn_handle, &message, sizeof message)
+       != 0) {
+        ++counters.rejected;
+    }
+    ++counters.writes;
+}
+
+void on_read(ble_npl_event *ev) {
+    auto &phone  = phone_of(ev);
+    uint16_t len = 0;
+    if(gatt_svr_inject_diag_read(phone.conn_handle, &len) != 0) {
+        ++counters.failed_reads;
+    }
+    else if(len >= phone.mtu - 1) {
+        ++counters.long_reads;
+    }
+    ++counters.reads;
+}
+
+/**
+ * @return false if the host has not run the same event of the last time yet
+ */
+bool post(ble_npl_event &ev) {
+    if(ble_npl_event_is_queued(&ev)) {
+        ++behind;
+        return false;
+    }
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &ev);
+    return true;
+}
+
+void connect(phone_t &phone, int64_t now) {
+    post(phone.connect_event);
+    phone.connected     = true;
+    phone.next_write_us = now + jittered(write_period_us);
+    phone.next_churn_us = churn_us > 0 ? now + jittered(churn_us) : INT64_MAX;
+    phone.next_mtu_us   = mtu_us > 0 ? now + jittered(mtu_us) : INT64_MAX;
+    phone.next_read_us  = read_us > 0 ? now + jittered(read_us) : INT64_MAX;
+}
+
+void disconnect(phone_t &phone, int64_t now) {
+    post(phone.disconnect_event);
+    // while disconnected the churn deadline is the one of the reconnect
+    phone.connected     = false;
+    phone.next_churn_us = now + jittered(reconnect_us);
+}
+
+void write(phone_t &phone, int64_t now) {
+    post(phone.write_event);
+    phone.next_write_us += write_period_us;
+    // a phone that fell behind does not catch up in a burst
+    if(phone.next_write_us < now) {
+        phone.next_write_us = now + write_period_us;
+    }
+}
+
+void step(phone_t &phone, int64_t now) {
+    if(!phone.connected) {
+        if(now >= phone.next_churn_us) {
+            connect(phone, now);
+        }
+        return;
+    }
+    if(now >= phone.next_churn_us) {
+        disconnect(phone, now);
+        return;
+    }
+    if(now >= phone.next_mtu_us) {
+        post(phone.mtu_event);
+        phone.next_mtu_us = now + jittered(mtu_us);
+    }
+    if(now >= phone.next_read_us) {
+        post(phone.read_event);
+        phone.next_read_us = now + jittered(read_us);
+    }
+    if(now >= phone.next_write_us) {
+        write(phone, now);
+    }
+}
+
+bool idle(phone_t &phone) {
+    for(auto *ev : {&phone.connect_event, &phone.disconnect_event,
+                    &phone.mtu_event, &phone.write_event, &phone.read_event}) {
+        if(ble_npl_event_is_queued(ev)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void init_phone(phone_t &phone, uint8_t index) {
+    phone.conn_handle = first_conn_handle + index;
+    // a random static address, one per phone
+    phone.addr = {BLE_ADDR_RANDOM, {index, 0x00, 0x00, 0x00, 0x10, 0xc0}};
+    ble_npl_event_init(&phone.connect_event, on_connect, &phone);
+    ble_npl_event_init(&phone.disconnect_event, on_disconnect, &phone);
+    ble_npl_event_init(&phone.mtu_event, on_mtu, &phone);
+    ble_npl_event_init(&phone.write_event, on_write, &phone);
+    ble_npl_event_init(&phone.read_event, on_read, &phone);
+}
+
+void report(const leds::stats_t &before, const leds::stats_t &after,
+            int64_t elapsed_us) {
+    leds::stats_t delta = after;
+    delta.pushed -= before.pushed;
+    delta.applied -= before.applied;
+    delta.coalesced -= before.coalesced;
+    for(uint8_t i = 0; i < leds::latency_buckets; ++i) {
+        delta.latency[i] -= before.latency[i];
+    }
+    const uint32_t elapsed_ms = elapsed_us / 1000;
+
+    ESP_LOGI(TAG, "%u phones for %u ms: %u writes, %u rejected", phones,
+             elapsed_ms, counters.writes, counters.rejected);
+    ESP_LOGI(TAG, "%u connects, %u disconnects, %u mtu changes",
+             counters.connects, counters.disconnects, counters.mtu_changes);
+    ESP_LOGI(TAG, "%u diagnostics reads, %u failed, %u filled the MTU",
+             counters.reads, counters.failed_reads, counters.long_reads);
+    ESP_LOGI(TAG, "%u events still queued on the host when due", behind);
+    ESP_LOGI(TAG, "%u pushed, %u applied (%u/s), %u coalesced, max depth %u",
+             delta.pushed, delta.applied,
+             elapsed_ms > 0 ? delta.applied * 1000 / elapsed_ms : 0,
+             delta.coalesced, after.max_depth);
+    ESP_LOGI(TAG, "apply latency p50 <%u us, p90 <%u us, p99 <%u us",
+             leds::latency_percentile(delta, 50),
+             leds::latency_percentile(delta, 90),
+             leds::latency_percentile(delta, 99));
+}
+
+void task(void *ignore) {
+    vTaskDelay(start_delay);
+
+    const auto before = leds::get_stats();
+    const auto start  = esp_timer_get_time();
+    for(uint8_t i = 0; i < phones; ++i) {
+        init_phone(phone_list[i], i);
+        connect(phone_list[i], start);
+    }
+
+    auto now = start;
+    while(now - start < duration_us) {
+        for(auto &phone : phone_list) {
+            step(phone, now);
+        }
+        vTaskDelay(1);
+        now = esp_timer_get_time();
+    }
+
+    for(auto &phone : phone_list) {
+        if(phone.connected) {
+            disconnect(phone, now);
+        }
+    }
+    // lets the host run what is still queued, then the event loop
+    for(auto &phone : phone_list) {
+        while(!idle(phone)) {
+            vTaskDelay(1);
+        }
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+    report(before, leds::get_stats(), now - start);
+    vTaskDelete(nullptr);
+}
+
+}  // namespace
+
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    // on the core of the NimBLE host, where the real writes come from
+    loadgen_task.create(task, "loadgen", tskIDLE_PRIORITY + 2, PRO_CPU_NUM);
+}
+
+}  // namespace loadgen
+
+#endif  // CONFIG_APP_LOADGEN
@@ -19,23 +19,55 @@
 
 #include "esp_bt.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 /* BLE */
 #include "esp_nimble_hci.h"
 #include "host/ble_hs.h"
 #include "host/util/util.h"
 #include "host/ble_hs_pvcy.h"
+#include "nimble/nimble_npl.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
 #include "services/gap/ble_svc_gap.h"
 #include "ble_server.h"
 
+#include "group.hpp"
+#include "ota.hpp"
 #include "uuids.h"
 
 static auto *tag = "BLE_SERVER";
 static int bleprph_gap_event(struct ble_gap_event *event, void *arg);
 static uint8_t own_addr_type;
 
+/* Advertising phases used to bring the last peer back quickly. */
+enum class adv_phase_t : uint8_t {
+    general,   // bleprph_advertise(), until a connection is made
+    directed,  // high duty cycle directed to the peer that just left
+    fast,      // undirected at a fast interval, for a short while
+    group,     // undirected carrying a group command, see group.hpp
+};
+
+static constexpr int32_t directed_adv_duration_ms = 1280;
+static constexpr int32_t fast_adv_duration_ms     = 30 * 1000;
+static constexpr uint16_t fast_adv_itvl_min       = BLE_GAP_ADV_ITVL_MS(20);
+static constexpr uint16_t fast_adv_itvl_max       = BLE_GAP_ADV_ITVL_MS(30);
+
+/* Group bursts go out at the shortest connectable interval, their data is
+ * refreshed often so that the countdown in it stays close to the truth. */
+static constexpr uint16_t group_adv_itvl    = BLE_GAP_ADV_ITVL_MS(20);
+static constexpr uint64_t group_refresh_us  = 10 * 1000;
+static constexpr uint16_t group_scan_itvl   = BLE_GAP_SCAN_ITVL_MS(40);
+static constexpr uint16_t group_scan_window = BLE_GAP_SCAN_WIN_MS(30);
+
+static adv_phase_t adv_phase = adv_phase_t::general;
+static esp_timer_handle_t group_timer;
+static struct ble_npl_event group_refresh_event;
+static bool group_listening = false;
+static ble_addr_t reconnect_peer;
+static int64_t reconnect_start_us = 0;  // 0 while no reconnect is pending
+static ble_reconnect_stats_t reconnect_stats;
+
 extern "C" void ble_store_config_init(void);
 
 /**
@@ -63,47 +95,55 @@ static void bleprph_print_conn_desc(struct ble_gap_conn_desc *desc) {
 }
 
 /**
- * Enables advertising with the following parameters:
- *     o General discoverable mode.
- *     o Undirected connectable mode.
+ * Sets the advertisement data included in our undirected advertisements:
+ *     o Flags (indicates advertisement type and other general info).
+ *     o Device name.
+ *     o one 128-bit service UUID.
  */
-static void bleprph_advertise(void) {
-    static struct ble_gap_adv_params adv_params;
+static int bleprph_set_adv_fields(void) {
     static struct ble_hs_adv_fields fields;
     static const char *name = ble_svc_gap_device_name();
 
-    /**
-     *  Set the advertisement data included in our advertisements:
-     *     o Flags (indicates advertisement type and other general info).
-     *     o Device name.
-     *     o one 128-bit service UUID.
-     */
-
     /* Advertise two flags:
      *     o Discoverability in forthcoming advertisement (general)
      *     o BLE-only (BR/EDR unsupported).
      */
-    if(!ble_gap_adv_active()) {
-        memset(&fields, 0, sizeof fields);
-        fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    memset(&fields, 0, sizeof fields);
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+
+    // Indicate that the TX power level field should NOT be included;
+    fields.tx_pwr_lvl_is_present = 0;
+    fields.tx_pwr_lvl            = BLE_HS_ADV_TX_PWR_LVL_AUTO;
 
-        // Indicate that the TX power level field should NOT be included;
-        fields.tx_pwr_lvl_is_present = 0;
-        fields.tx_pwr_lvl            = BLE_HS_ADV_TX_PWR_LVL_AUTO;
+    fields.name             = (uint8_t *)name;
+    fields.name_len         = strlen(name);
+    fields.name_is_complete = 1;
 
-        fields.name             = (uint8_t *)name;
-        fields.name_len         = strlen(name);
-        fields.name_is_complete = 1;
+    /* No memory for 128 bit adv (error msg size) */
+    static ble_uuid128_t adv_svc_uuid = GATT_SVC_ADV_UUID;
+    fields.uuids128                   = &adv_svc_uuid;
+    fields.num_uuids128               = 1;
+    fields.uuids128_is_complete       = 1;
 
-        /* No memory for 128 bit adv (error msg size) */
-        static ble_uuid128_t adv_svc_uuid = GATT_SVC_ADV_UUID;
-        fields.uuids128                   = &adv_svc_uuid;
-        fields.num_uuids128               = 1;
-        fields.uuids128_is_complete       = 1;
+    int rc = ble_gap_adv_set_fields(&fields);
+    if(rc != 0) {
+        MODLOG_DFLT(ERROR, "error setting advertisement data; rc=%d\n", rc);
+    }
+    return rc;
+}
+
+/**
+ * Enables advertising with the following parameters:
+ *     o General discoverable mode.
+ *     o Undirected connectable mode.
+ */
+static void bleprph_advertise(void) {
+    static struct ble_gap_adv_params adv_params;
 
-        int rc = ble_gap_adv_set_fields(&fields);
+    if(!ble_gap_adv_active()) {
+        adv_phase = adv_phase_t::general;
+        int rc    = bleprph_set_adv_fields();
         if(rc != 0) {
-            MODLOG_DFLT(ERROR, "error setting advertisement data; rc=%d\n", rc);
             return;
         }
 
@@ -125,6 +165,282 @@ static void bleprph_advertise(void) {
     return;
 }
 
+/**
+ * Second reconnect phase: undirected connectable advertising at a fast
+ * interval for a short while, then back to bleprph_advertise().
+ */
+static void bleprph_advertise_fast(void) {
+    static struct ble_gap_adv_params adv_params;
+
+    ble_gap_adv_stop();
+    adv_phase = adv_phase_t::fast;
+    int rc    = bleprph_set_adv_fields();
+    if(rc != 0) {
+        bleprph_advertise();
+        return;
+    }
+
+    memset(&adv_params, 0, sizeof adv_params);
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    adv_params.itvl_min  = fast_adv_itvl_min;
+    adv_params.itvl_max  = fast_adv_itvl_max;
+
+    rc = ble_gap_adv_start(own_addr_type, NULL, fast_adv_duration_ms,
+                           &adv_params, bleprph_gap_event, NULL);
+    if(rc != 0) {
+        MODLOG_DFLT(ERROR, "error enabling fast advertisement; rc=%d\n", rc);
+        bleprph_advertise();
+    }
+}
+
+/**
+ * First reconnect phase: high duty cycle directed advertising to the peer
+ * that just left, at the address it last used. The controller stops it
+ * after 1.28 s at most; a peer that has moved on to a new resolvable
+ * private address will not answer it, so the fast phase follows either way.
+ */
+static void bleprph_advertise_directed(const ble_addr_t *peer) {
+    static struct ble_gap_adv_params adv_params;
+
+    ble_gap_adv_stop();
+    adv_phase = adv_phase_t::directed;
+
+    memset(&adv_params, 0, sizeof adv_params);
+    adv_params.conn_mode       = BLE_GAP_CONN_MODE_DIR;
+    adv_params.disc_mode       = BLE_GAP_DISC_MODE_NON;
+    adv_params.high_duty_cycle = 1;
+
+    int rc = ble_gap_adv_start(own_addr_type, peer, directed_adv_duration_ms,
+                               &adv_params, bleprph_gap_event, NULL);
+    if(rc != 0) {
+        MODLOG_DFLT(ERROR, "error enabling directed advertisement; rc=%d\n",
+                    rc);
+        bleprph_advertise_fast();
+    }
+}
+
+/**
+ * Sets the advertisement data of a group burst: the flags and the group
+ * packet as manufacturer data, no room is left for the name.
+ *
+ * @return                      BLE_HS_EDONE once the burst is over.
+ */
+static int bleprph_set_group_fields(void) {
+    static uint8_t packet[sizeof(group::packet_t)];
+    static struct ble_hs_adv_fields fields;
+
+    size_t len = group::payload(packet);
+    if(len == 0) {
+        return BLE_HS_EDONE;
+    }
+
+    memset(&fields, 0, sizeof fields);
+    fields.flags        = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.mfg_data     = packet;
+    fields.mfg_data_len = len;
+    return ble_gap_adv_set_fields(&fields);
+}
+
+/**
+ * Runs on the host task every group_refresh_us during a burst, back to
+ * bleprph_advertise() once it is over.
+ */
+static void bleprph_group_refresh(struct ble_npl_event *ev) {
+    if(adv_phase != adv_phase_t::group) {
+        esp_timer_stop(group_timer);
+        return;
+    }
+    if(bleprph_set_group_fields() != 0) {
+        esp_timer_stop(group_timer);
+        ble_gap_adv_stop();
+        bleprph_advertise();
+    }
+}
+
+static void bleprph_reconnect_preempt(void);
+
+/**
+ * The group timer, on the esp_timer task. The advertising state belongs to
+ * the host task, the refresh is queued to it.
+ */
+static void bleprph_group_tick(void *arg) {
+    if(!ble_npl_event_is_queued(&group_refresh_event)) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(),
+                           &group_refresh_event);
+    }
+}
+
+/**
+ * Advertises the group command just sent. The burst stays connectable, the
+ * controller does not allow non-connectable advertising faster than 100 ms.
+ *
+ * A burst takes over from a reconnect in progress, the group applies the
+ * command in delay_ms whether it was heard or not. The reconnect is given
+ * up, counted as preempted, and the peer falls back to the general
+ * advertising after the burst.
+ */
+void ble_group_broadcast(void) {
+    static struct ble_gap_adv_params adv_params;
+
+    esp_timer_stop(group_timer);
+    if(reconnect_start_us != 0) {
+        bleprph_reconnect_preempt();
+    }
+    ble_gap_adv_stop();
+    adv_phase = adv_phase_t::group;
+    int rc    = bleprph_set_group_fields();
+    if(rc != 0) {
+        bleprph_advertise();
+        return;
+    }
+
+    memset(&adv_params, 0, sizeof adv_params);
+    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    adv_params.itvl_min  = group_adv_itvl;
+    adv_params.itvl_max  = group_adv_itvl;
+
+    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER, &adv_params,
+                           bleprph_gap_event, NULL);
+    if(rc != 0) {
+        MODLOG_DFLT(ERROR, "error enabling group advertisement; rc=%d\n", rc);
+        bleprph_advertise();
+        return;
+    }
+    esp_timer_start_periodic(group_timer, group_refresh_us);
+}
+
+static void bleprph_scan(void);
+
+/**
+ * Discovery events of the group scan, the manufacturer data of everything
+ * around goes to group::receive() to pick ours out.
+ */
+static int bleprph_scan_event(struct ble_gap_event *event, void *arg) {
+    struct ble_hs_adv_fields fields;
+
+    switch(event->type) {
+        case BLE_GAP_EVENT_DISC:
+            if(ble_hs_adv_parse_fields(&fields, event->disc.data,
+                                       event->disc.length_data)
+                   == 0
+               && fields.mfg_data_len > 0) {
+                group::receive(fields.mfg_data, fields.mfg_data_len);
+            }
+            return 0;
+
+        case BLE_GAP_EVENT_DISC_COMPLETE:
+            bleprph_scan();
+            return 0;
+    }
+    return 0;
+}
+
+/**
+ * Passive scan while in a group, with duplicates reported: the controller
+ * filters by address and would hide every burst of a sender after its first
+ * one. Only the first packet of a burst is taken, group::receive() drops
+ * its repeats.
+ */
+static void bleprph_scan(void) {
+    static struct ble_gap_disc_params disc_params;
+
+    if(!group_listening || ble_gap_disc_active()) {
+        return;
+    }
+
+    memset(&disc_params, 0, sizeof disc_params);
+    disc_params.itvl              = group_scan_itvl;
+    disc_params.window            = group_scan_window;
+    disc_params.passive           = 1;
+    disc_params.filter_duplicates = 0;
+
+    int rc = ble_gap_disc(own_addr_type, BLE_HS_FOREVER, &disc_params,
+                          bleprph_scan_event, NULL);
+    if(rc != 0) {
+        MODLOG_DFLT(ERROR, "error starting the group scan; rc=%d\n", rc);
+    }
+}
+
+void ble_group_listen(bool on) {
+    group_listening = on;
+    // before the sync the scan starts in bleprph_on_sync()
+    if(on && ble_hs_synced()) {
+        bleprph_scan();
+    }
+    else if(ble_gap_disc_active()) {
+        ble_gap_disc_cancel();
+    }
+}
+
+/**
+ * Gives up on the pending reconnect, the peer did not come back while we
+ * were advertising fast or someone else connected first.
+ */
+static void bleprph_reconnect_abandon(void) {
+    if(reconnect_start_us != 0) {
+        reconnect_start_us = 0;
+        reconnect_peer     = {};
+        reconnect_stats.missed++;
+    }
+}
+
+/**
+ * Gives up on the pending reconnect, or the one about to begin, for a group
+ * burst.
+ */
+static void bleprph_reconnect_preempt(void) {
+    reconnect_start_us = 0;
+    reconnect_peer     = {};
+    reconnect_stats.preempted++;
+}
+
+/**
+ * Starts the reconnect sequence after a peer disconnects. Nothing is bonded,
+ * so the peer is known by the address it used over the air, not by an
+ * identity address.
+ */
+static void bleprph_reconnect_begin(const struct ble_gap_conn_desc *desc) {
+    bleprph_reconnect_abandon();
+    reconnect_peer     = desc->peer_ota_addr;
+    reconnect_start_us = esp_timer_get_time();
+    bleprph_advertise_directed(&reconnect_peer);
+}
+
+/**
+ * Records the time to reconnect when the pending peer connects again, any
+ * other peer ends the wait.
+ */
+static void bleprph_reconnect_measure(const struct ble_gap_conn_desc *desc) {
+    if(reconnect_start_us == 0) {
+        return;
+    }
+    if(ble_addr_cmp(&desc->peer_ota_addr, &reconnect_peer) != 0) {
+        bleprph_reconnect_abandon();
+        return;
+    }
+
+    auto elapsed_ms = static_cast<uint32_t>(
+        (esp_timer_get_time() - reconnect_start_us) / 1000);
+    reconnect_start_us = 0;
+
+    auto &stats = reconnect_stats;
+    if(stats.count == 0 || elapsed_ms < stats.min_ms) {
+        stats.min_ms = elapsed_ms;
+    }
+    if(elapsed_ms > stats.max_ms) {
+        stats.max_ms = elapsed_ms;
+    }
+    stats.last_ms = elapsed_ms;
+    stats.total_ms += elapsed_ms;
+    stats.count++;
+    if(adv_phase == adv_phase_t::directed) {
+        stats.directed++;
+    }
+    ESP_LOGI(tag, "peer reconnected in %u ms", elapsed_ms);
+}
+
 /**
  * The nimble host executes this callback when a GAP event occurs.  The
  * application associates a GAP event callback with each connection that forms.
@@ -159,11 +475,12 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
                         event->connect.status == 0 ? "established" : "failed",
                         event->connect.status);
 
-            if(event->connect.status == 0) {
-                rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
-                assert(rc == 0);
+            // the handles of the load generator have no connection behind
+            if(event->connect.status == 0
+               && ble_gap_conn_find(event->connect.conn_handle, &desc) == 0) {
                 bleprph_print_conn_desc(&desc);
                 MODLOG_DFLT(INFO, "\n");
+                bleprph_reconnect_measure(&desc);
 
                 // ble_gap_security_initiate(event->connect.conn_handle);
             }
@@ -179,8 +496,15 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
             bleprph_print_conn_desc(&event->disconnect.conn);
             MODLOG_DFLT(INFO, "\n");
 
-            /* Connection terminated; resume advertising. */
-            bleprph_advertise();
+            /* Connection terminated; try to get the peer back before falling
+             * back to the general advertising. A group burst running keeps
+             * going, the peer finds the general advertising after it. */
+            if(adv_phase != adv_phase_t::group) {
+                bleprph_reconnect_begin(&event->disconnect.conn);
+            }
+            else {
+                bleprph_reconnect_preempt();
+            }
             return 0;
 
         case BLE_GAP_EVENT_CONN_UPDATE:
@@ -196,7 +520,15 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
         case BLE_GAP_EVENT_ADV_COMPLETE:
             MODLOG_DFLT(INFO, "advertise complete; reason=%d",
                         event->adv_complete.reason);
-            bleprph_advertise();
+            if(adv_phase == adv_phase_t::directed) {
+                bleprph_advertise_fast();
+            }
+            else {
+                if(adv_phase == adv_phase_t::fast) {
+                    bleprph_reconnect_abandon();
+                }
+                bleprph_advertise();
+            }
             return 0;
 
         case BLE_GAP_EVENT_ENC_CHANGE:
@@ -250,7 +582,9 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
             memset(&pkey, 0, sizeof pkey);
 
             if(event->passkey.params.action == BLE_SM_IOACT_DISP) {
-                pkey.action = event->passkey.params.action;
+                // nothing to show it on, the one the OTA asks for
+                pkey.action  = event->passkey.params.action;
+                pkey.passkey = CONFIG_APP_OTA_PASSKEY;
 
                 // i2c::ds3232::read_ram(0, &pkey.passkey, sizeof pkey.passkey);
                 // ssd1306::show_password(pkey.passkey);
@@ -274,6 +608,58 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
     return 0;
 }
 
+#if CONFIG_APP_LOADGEN
+/* The handles of the load generator have no connection behind them and
+ * ble_att_mtu() returns 0 for those, their MTU is kept here instead. Only
+ * the host task touches it. */
+static struct {
+    uint16_t conn_handle;
+    uint16_t mtu; /* 0 for a free entry */
+} inject_mtus[CONFIG_APP_LOADGEN_PHONES];
+
+static void ble_inject_set_mtu(uint16_t conn_handle, uint16_t mtu) {
+    auto *free_entry = &inject_mtus[0];
+    for(auto &entry : inject_mtus) {
+        if(entry.mtu != 0 && entry.conn_handle == conn_handle) {
+            entry.mtu = mtu;
+            return;
+        }
+        if(entry.mtu == 0) {
+            free_entry = &entry;
+        }
+    }
+    if(mtu != 0) {
+        *free_entry = {conn_handle, mtu};
+    }
+}
+
+int ble_inject_gap_event(struct ble_gap_event *event) {
+    switch(event->type) {
+        case BLE_GAP_EVENT_CONNECT:
+            ble_inject_set_mtu(event->connect.conn_handle, BLE_ATT_MTU_DFLT);
+            break;
+        case BLE_GAP_EVENT_DISCONNECT:
+            ble_inject_set_mtu(event->disconnect.conn.conn_handle, 0);
+            break;
+        case BLE_GAP_EVENT_MTU:
+            ble_inject_set_mtu(event->mtu.conn_handle, event->mtu.value);
+            break;
+        default:
+            break;
+    }
+    return bleprph_gap_event(event, NULL);
+}
+
+uint16_t ble_inject_mtu(uint16_t conn_handle) {
+    for(const auto &entry : inject_mtus) {
+        if(entry.mtu != 0 && entry.conn_handle == conn_handle) {
+            return entry.mtu;
+        }
+    }
+    return 0;
+}
+#endif
+
 static void bleprph_on_reset(int reason) {
     MODLOG_DFLT(ERROR, "Resetting state; reason=%d\n", reason);
 }
@@ -303,6 +689,14 @@ static void bleprph_on_sync(void) {
 
     /* Begin advertising. */
     bleprph_advertise();
+    bleprph_scan();
+
+    /* a phone can reach us to fix things, a new image has done its part */
+    ota::confirm();
+}
+
+void ble_get_reconnect_stats(ble_reconnect_stats_t *stats) {
+    *stats = reconnect_stats;
 }
 
 void bleprph_host_task(void *param) {
@@ -325,7 +719,9 @@ void nimble_ble_init(void) {
     ble_hs_cfg.gatts_register_cb = gatt_svr_register_cb;
     ble_hs_cfg.store_status_cb   = ble_store_util_status_rr;
 
-    ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_NO_IO;
+    /* a fixed passkey "displayed", pairing with it is authenticated and the
+     * OTA characteristics take writes only over such a link */
+    ble_hs_cfg.sm_io_cap = BLE_SM_IO_CAP_DISP_ONLY;
 
     /* bonding habilitado, enquanto a ESP32 permanecer ligada */
     // ble_hs_cfg.sm_bonding = 1; /* bonding */
@@ -339,9 +735,18 @@ void nimble_ble_init(void) {
     // ble_hs_cfg.sm_our_key_dist   = BLE_SM_PAIR_KEY_DIST_ID;
     // ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ID;
 
-    // ble_hs_cfg.sm_mitm = 1;
-    // ble_hs_cfg.sm_sc   = 1; /* secure connection */
+    ble_hs_cfg.sm_mitm = 1;
+    ble_hs_cfg.sm_sc   = 1; /* secure connection */
+
 
+    const esp_timer_create_args_t timer_args = {
+        .callback        = bleprph_group_tick,
+        .arg             = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "group_adv",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &group_timer));
+    ble_npl_event_init(&group_refresh_event, bleprph_group_refresh, NULL);
 
     int rc = gatt_svr_init();
     assert(rc == 0);
@@ -24,13 +24,69 @@
 #include "ble_server.h"
 #include "uuids.h"
 
+#include "ambient.hpp"
+#include "effects.hpp"
+#include "group.hpp"
 #include "leds.hpp"
+#include "ota.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
 
 static constexpr auto* TAG = "GATT";
 
 /* UUIDs of Services and Characteristics */
 static constexpr ble_uuid128_t uuid_svc_adv         = GATT_SVC_ADV_UUID;
 static constexpr ble_uuid128_t uuid_char_brightness = GATT_CHAR_BRIGHTNESS_UUID;
+static constexpr ble_uuid128_t uuid_char_schedule   = GATT_CHAR_SCHEDULE_UUID;
+static constexpr ble_uuid128_t uuid_char_clock      = GATT_CHAR_CLOCK_UUID;
+static constexpr ble_uuid128_t uuid_char_effect     = GATT_CHAR_EFFECT_UUID;
+static constexpr ble_uuid128_t uuid_char_auto_bri
+    = GATT_CHAR_AUTO_BRIGHTNESS_UUID;
+static constexpr ble_uuid128_t uuid_char_diag
+    = GATT_CHAR_DIAGNOSTICS_UUID;
+static constexpr ble_uuid128_t uuid_char_pwm_profile
+    = GATT_CHAR_PWM_PROFILE_UUID;
+static constexpr ble_uuid128_t uuid_char_group      = GATT_CHAR_GROUP_UUID;
+static constexpr ble_uuid128_t uuid_svc_ota         = GATT_SVC_OTA_UUID;
+static constexpr ble_uuid128_t uuid_char_ota_ctrl   = GATT_CHAR_OTA_CONTROL_UUID;
+static constexpr ble_uuid128_t uuid_char_ota_data   = GATT_CHAR_OTA_DATA_UUID;
+
+/* Diagnostics: a write selects a page, reads walk through it. */
+enum diag_page_t : uint8_t {
+    diag_page_trace = 1,
+    // the stats pages ignore the cursor, they are taken when selected
+    diag_page_watchdog,   // watchdog::stats_t
+    diag_page_reconnect,  // ble_reconnect_stats_t
+    diag_page_effects,    // effects::stats_t
+};
+
+struct __attribute__((packed)) diag_select_t {
+    diag_page_t page;
+    uint32_t cursor;  // trace: first event wanted, 0 for the oldest
+};
+
+struct __attribute__((packed)) diag_trace_header_t {
+    uint32_t cursor;  // of the first event in this read
+    uint32_t head;    // of the next event to be recorded
+};
+
+static diag_page_t diag_page = diag_page_trace;
+static uint32_t diag_cursor  = 0;
+
+/* The stats pages are longer than a default MTU, a client reads them with a
+ * Read Blob after the first part and each part runs the read callback again.
+ * They are copied once when the page is selected, so all parts come from the
+ * same copy. */
+static union {
+    watchdog::stats_t watchdog;
+    ble_reconnect_stats_t reconnect;
+    effects::stats_t effects;
+} diag_snapshot;
+static size_t diag_snapshot_len = 0;
+
+static uint16_t ota_conn_handle;
+static uint16_t ota_ctrl_val_handle;
 
 
 static int gatt_svr_chr_access(uint16_t conn_handle, uint16_t attr_handle,
@@ -54,6 +110,67 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
                 .flags = BLE_GATT_CHR_F_WRITE,  // | BLE_GATT_CHR_F_WRITE_ENC,
                                                 // flags
             },
+            {
+                .uuid      = &uuid_char_schedule.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_clock.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_effect.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_auto_bri.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_diag.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_pwm_profile.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                .uuid      = &uuid_char_group.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+            },
+            {
+                0, // No more characteristics in this service.
+            },
+        },
+    },
+    {
+        .type            = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid            = &uuid_svc_ota.u,
+        .includes        = nullptr,
+        .characteristics =
+        (struct ble_gatt_chr_def[]){
+            {
+                .uuid       = &uuid_char_ota_ctrl.u,
+                .access_cb  = gatt_svr_chr_access,
+                .flags      = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_ENC
+                              | BLE_GATT_CHR_F_WRITE_AUTHEN
+                              | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &ota_ctrl_val_handle,
+            },
+            {
+                .uuid      = &uuid_char_ota_data.u,
+                .access_cb = gatt_svr_chr_access,
+                .flags     = BLE_GATT_CHR_F_WRITE_NO_RSP
+                             | BLE_GATT_CHR_F_WRITE_ENC
+                             | BLE_GATT_CHR_F_WRITE_AUTHEN,
+            },
             {
                 0, // No more characteristics in this service.
             },
@@ -84,6 +201,74 @@ static int gatt_svr_chr_write(struct os_mbuf* om, uint16_t min_len,
     return 0;
 }
 
+static void ota_notify(const void* data, size_t len) {
+    struct os_mbuf* om = ble_hs_mbuf_from_flat(data, len);
+    if(om != nullptr) {
+        ble_gattc_notify_custom(ota_conn_handle, ota_ctrl_val_handle, om);
+    }
+}
+
+static void gatt_svr_diag_select(const diag_select_t& select) {
+    diag_page   = select.page;
+    diag_cursor = select.cursor;
+    switch(diag_page) {
+        case diag_page_watchdog:
+            diag_snapshot.watchdog = watchdog::get_stats();
+            diag_snapshot_len      = sizeof diag_snapshot.watchdog;
+            break;
+        case diag_page_reconnect:
+            ble_get_reconnect_stats(&diag_snapshot.reconnect);
+            diag_snapshot_len = sizeof diag_snapshot.reconnect;
+            break;
+        case diag_page_effects:
+            diag_snapshot.effects = effects::get_stats();
+            diag_snapshot_len     = sizeof diag_snapshot.effects;
+            break;
+        default:
+            diag_snapshot_len = 0;
+            break;
+    }
+}
+
+/**
+ * Fills one read of the diagnostics characteristic. A trace read stays under
+ * MTU - 1 bytes: a full one makes the client follow up with a Read Blob, which
+ * runs this again and would move the cursor past events it never got.
+ */
+static int gatt_svr_diag_read(uint16_t conn_handle, struct os_mbuf* om) {
+    constexpr size_t max_events = 32;
+    size_t mtu = ble_att_mtu(conn_handle);
+#if CONFIG_APP_LOADGEN
+    if(mtu == 0) {
+        mtu = ble_inject_mtu(conn_handle);
+    }
+#endif
+    mtu = mtu > BLE_ATT_MTU_DFLT ? mtu : BLE_ATT_MTU_DFLT;
+    // the ATT opcode takes one byte, one more keeps the response short
+    const size_t room = mtu - 2;
+
+    if(diag_page == diag_page_trace) {
+        trace::event_t events[max_events];
+        diag_trace_header_t header;
+        size_t count  = (room - sizeof header) / sizeof(trace::event_t);
+        count         = count < max_events ? count : max_events;
+        count         = trace::read(diag_cursor, events, count);
+        header.cursor = diag_cursor - count;
+        header.head   = trace::get_head();
+
+        int rc = os_mbuf_append(om, &header, sizeof header);
+        if(rc == 0) {
+            rc = os_mbuf_append(om, events, count * sizeof(trace::event_t));
+        }
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    if(diag_snapshot_len > 0) {
+        int rc = os_mbuf_append(om, &diag_snapshot, diag_snapshot_len);
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
 bool pass_invalid(uint32_t received_pass) {
     // TODO pass_invalid ?
     return false;
@@ -104,8 +289,142 @@ static int gatt_svr_chr_access(uint16_t conn_handle, uint16_t attr_handle,
         leds::message_t message;
         constexpr auto msize = sizeof message;
         rc = gatt_svr_chr_write(ctxt->om, msize, msize, &message, nullptr);
+        if(rc == 0 && !leds::is_valid(message.channel)) {
+            return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+        }
+        if(rc == 0) {
+            trace::record(trace::ble_write, message.channel,
+                          message.brightness);
+            // setting it by hand takes it over from the automatics
+            ambient::set_enabled(false);
+            effects::stop();
+            scheduler::cancel_ramp(message.channel);
+            // in a group it is applied later, together with the others
+            if(!group::send(message)) {
+                leds::push_message(message);
+            }
+        }
+        return rc;
+    }
+
+    // schedule entries, always replaced as a whole
+    if(ble_uuid_cmp(uuid, &uuid_char_schedule.u) == 0) {
+        using scheduler::entry_t;
+        if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            entry_t entries[scheduler::max_entries];
+            auto count = scheduler::get_entries(entries);
+            rc = os_mbuf_append(ctxt->om, entries, count * sizeof(entry_t));
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        if(rc != 0 || len % sizeof(entry_t) != 0
+           || len / sizeof(entry_t) > scheduler::max_entries) {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        // a bad day mask, minute, channel or brightness rejects them all
+        bool ok = scheduler::set_entries(
+            reinterpret_cast<const entry_t*>(buffer), len / sizeof(entry_t));
+        return ok ? 0 : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    // a single byte picks a built in effect, anything longer is a program
+    if(ble_uuid_cmp(uuid, &uuid_char_effect.u) == 0) {
+        if(rc != 0) {
+            return rc;
+        }
+        bool ok
+            = len == 1
+                  ? effects::play(static_cast<effects::builtin_t>(buffer[0]))
+                  : effects::load(buffer, len);
+        return ok ? 0 : BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
+    // auto brightness on (1) or off (0)
+    if(ble_uuid_cmp(uuid, &uuid_char_auto_bri.u) == 0) {
+        uint8_t enabled = ambient::is_enabled();
+        if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            rc = os_mbuf_append(ctxt->om, &enabled, sizeof enabled);
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        constexpr auto esize = sizeof enabled;
+        rc = gatt_svr_chr_write(ctxt->om, esize, esize, &enabled, nullptr);
+        if(rc == 0) {
+            ambient::set_enabled(enabled != 0);
+        }
+        return rc;
+    }
+
+    if(ble_uuid_cmp(uuid, &uuid_char_diag.u) == 0) {
+        if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            return gatt_svr_diag_read(conn_handle, ctxt->om);
+        }
+        diag_select_t select;
+        constexpr auto ssize = sizeof select;
+        rc = gatt_svr_chr_write(ctxt->om, ssize, ssize, &select, nullptr);
+        if(rc == 0) {
+            gatt_svr_diag_select(select);
+        }
+        return rc;
+    }
+
+    // reads the profile of each channel, writes {channel mask, profile}
+    if(ble_uuid_cmp(uuid, &uuid_char_pwm_profile.u) == 0) {
+        if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            const leds::profile_t profiles[2] = {
+                leds::get_profile(leds::channel0),
+                leds::get_profile(leds::channel1),
+            };
+            rc = os_mbuf_append(ctxt->om, profiles, sizeof profiles);
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        if(rc != 0 || len != 2) {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        bool ok = leds::set_profile(buffer[0],
+                                    static_cast<leds::profile_t>(buffer[1]));
+        return ok ? 0 : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    // reads the group and its counters, writes a group::join_t
+    if(ble_uuid_cmp(uuid, &uuid_char_group.u) == 0) {
+        if(ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR) {
+            const uint8_t group_id = group::get_group();
+            const auto stats       = group::get_stats();
+            rc = os_mbuf_append(ctxt->om, &group_id, sizeof group_id);
+            rc |= os_mbuf_append(ctxt->om, &stats, sizeof stats);
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        group::join_t join;
+        constexpr auto jsize = sizeof join;
+        rc = gatt_svr_chr_write(ctxt->om, jsize, jsize, &join, nullptr);
+        if(rc == 0) {
+            group::join(join);
+        }
+        return rc;
+    }
+
+    // firmware update, see ota.hpp for the protocol
+    if(ble_uuid_cmp(uuid, &uuid_char_ota_ctrl.u) == 0) {
+        if(rc != 0) {
+            return rc;
+        }
+        ota_conn_handle = conn_handle;
+        return ota::control(buffer, len) ? 0 : BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+    }
+
+    if(ble_uuid_cmp(uuid, &uuid_char_ota_data.u) == 0) {
+        if(rc != 0) {
+            return rc;
+        }
+        return ota::write(buffer, len) ? 0 : BLE_ATT_ERR_UNLIKELY;
+    }
+
+    // local time, seconds since the epoch
+    if(ble_uuid_cmp(uuid, &uuid_char_clock.u) == 0) {
+        uint32_t local_epoch = 0;
+        constexpr auto esize = sizeof local_epoch;
+        rc = gatt_svr_chr_write(ctxt->om, esize, esize, &local_epoch, nullptr);
         if(rc == 0) {
-            leds::push_message(message);
+            scheduler::set_time(local_epoch);
         }
         return rc;
     }
@@ -145,11 +464,43 @@ void gatt_svr_register_cb(struct ble_gatt_register_ctxt* ctxt, void* arg) {
     }
 }
 
+#if CONFIG_APP_LOADGEN
+int gatt_svr_inject_write(uint16_t conn_handle, const void* data,
+                          uint16_t len) {
+    struct ble_gatt_access_ctxt ctxt = {};
+    ctxt.op  = BLE_GATT_ACCESS_OP_WRITE_CHR;
+    ctxt.om  = ble_hs_mbuf_from_flat(data, len);
+    ctxt.chr = &gatt_svr_svcs[0].characteristics[0];  // brightness
+    if(ctxt.om == nullptr) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    int rc = gatt_svr_chr_access(conn_handle, 0, &ctxt, nullptr);
+    os_mbuf_free_chain(ctxt.om);
+    return rc;
+}
+
+int gatt_svr_inject_diag_read(uint16_t conn_handle, uint16_t* len) {
+    struct ble_gatt_access_ctxt ctxt = {};
+    ctxt.op  = BLE_GATT_ACCESS_OP_READ_CHR;
+    ctxt.om  = ble_hs_mbuf_att_pkt();
+    ctxt.chr = &gatt_svr_svcs[0].characteristics[5];  // diagnostics
+    if(ctxt.om == nullptr) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    int rc = gatt_svr_chr_access(conn_handle, 0, &ctxt, nullptr);
+    *len   = OS_MBUF_PKTLEN(ctxt.om);
+    os_mbuf_free_chain(ctxt.om);
+    return rc;
+}
+#endif
+
 int gatt_svr_init(void) {
     int rc = -1;
 
     ble_svc_gap_init();
     ble_svc_gatt_init();
+    ota::init(ota_notify);
+    group::init(ble_group_broadcast, ble_group_listen);
 
     rc = ble_gatts_count_cfg(gatt_svr_svcs);
     if(rc != 0) {
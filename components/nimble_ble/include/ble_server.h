@@ -19,7 +19,7 @@
 
 #pragma once
 
-// #include <stdbool.h>
+#include <stdbool.h>
 #include "nimble/ble.h"
 #include "modlog/modlog.h"
 #ifdef __cplusplus
@@ -37,6 +37,39 @@ struct ble_gatt_register_ctxt;
 #define GATT_SVR_CHR_UNR_ALERT_STAT_UUID      0x2A45
 #define GATT_SVR_CHR_ALERT_NOT_CTRL_PT        0x2A44
 
+/** Time to reconnect of the last peer, in milliseconds, read over the
+ * diagnostics characteristic. */
+typedef struct {
+    uint32_t count;     /* reconnects measured */
+    uint32_t directed;  /* of which were caught by directed advertising */
+    uint32_t missed;    /* not back while advertising fast, or another peer
+                           connected first */
+    uint32_t last_ms;
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t total_ms;
+    uint32_t preempted; /* given up, or never begun, for a group burst */
+} ble_reconnect_stats_t;
+
+void ble_get_reconnect_stats(ble_reconnect_stats_t *stats);
+
+#if CONFIG_APP_LOADGEN
+/** Load generator hooks, run the handlers as if the host had called them.
+ * Only from the host task, as events on its queue. */
+struct ble_gap_event;
+int ble_inject_gap_event(struct ble_gap_event *event);
+/** The MTU last injected for a handle, 0 if it is not connected. */
+uint16_t ble_inject_mtu(uint16_t conn_handle);
+int gatt_svr_inject_write(uint16_t conn_handle, const void *data,
+                          uint16_t len);
+/** A read of the diagnostics characteristic, len is the response size. */
+int gatt_svr_inject_diag_read(uint16_t conn_handle, uint16_t *len);
+#endif
+
+/** Group sync, see group.hpp. */
+void ble_group_broadcast(void);
+void ble_group_listen(bool on);
+
 void gatt_svr_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg);
 int gatt_svr_init(void);
 void nimble_ble_init(void);
@@ -3,10 +3,17 @@
 /*
 e7946a77-561c-4e63-aae7-b5d6a9e15525 // in use
 1879224c-9358-4be2-8089-5750ca67756c // in use 
-46ac1f62-7e90-4d56-9adb-31e3663bb755
-24b83068-e707-4a19-b595-09cd62fb1b8c
-afe05301-efc2-4fb4-8bca-35446dae2f46
+46ac1f62-7e90-4d56-9adb-31e3663bb755 // in use
+24b83068-e707-4a19-b595-09cd62fb1b8c // in use
+afe05301-efc2-4fb4-8bca-35446dae2f46 // in use
 9593a690-3529-4a9b-bbf0-673d3cb52692
+0e5ea65c-1e5a-45e8-a3d2-dc4eff3f1340 // in use
+34eb7795-2c7f-400f-878d-aef3f79899d9 // in use
+63747538-898b-45ad-a1a0-a89695fbd1e3 // in use
+fb63f979-35ee-4e30-9c4f-ec7a670b9114 // in use
+beb8d7d8-80b0-46b4-ae51-6b0427ec125a // in use
+44b578d2-bca0-4ef3-879a-25f9bbe22930 // in use
+8a1537ef-6402-4515-8f23-a9defef55e0b // in use
 */
 
 #include "host/ble_uuid.h"
@@ -35,6 +42,66 @@ extern "C" {
     BLE_UUID128_INIT(0x6c, 0x75, 0x67, 0xca, 0x50, 0x57, 0x89, 0x80, 0xe2, \
                      0x4b, 0x58, 0x93, 0x4c, 0x22, 0x79, 0x18);
 
+// 46 ac 1f 62-7e 90-4d 56-9a db-31 e3 66 3b b7 55
+// 46ac1f62-7e90-4d56-9adb-31e3663bb755
+#define GATT_CHAR_SCHEDULE_UUID                                            \
+    BLE_UUID128_INIT(0x55, 0xb7, 0x3b, 0x66, 0xe3, 0x31, 0xdb, 0x9a, 0x56, \
+                     0x4d, 0x90, 0x7e, 0x62, 0x1f, 0xac, 0x46);
+
+// 24 b8 30 68-e7 07-4a 19-b5 95-09 cd 62 fb 1b 8c
+// 24b83068-e707-4a19-b595-09cd62fb1b8c
+#define GATT_CHAR_CLOCK_UUID                                               \
+    BLE_UUID128_INIT(0x8c, 0x1b, 0xfb, 0x62, 0xcd, 0x09, 0x95, 0xb5, 0x19, \
+                     0x4a, 0x07, 0xe7, 0x68, 0x30, 0xb8, 0x24);
+
+// af e0 53 01-ef c2-4f b4-8b ca-35 44 6d ae 2f 46
+// afe05301-efc2-4fb4-8bca-35446dae2f46
+#define GATT_CHAR_EFFECT_UUID                                              \
+    BLE_UUID128_INIT(0x46, 0x2f, 0xae, 0x6d, 0x44, 0x35, 0xca, 0x8b, 0xb4, \
+                     0x4f, 0xc2, 0xef, 0x01, 0x53, 0xe0, 0xaf);
+
+// 0e 5e a6 5c-1e 5a-45 e8-a3 d2-dc 4e ff 3f 13 40
+// 0e5ea65c-1e5a-45e8-a3d2-dc4eff3f1340
+#define GATT_SVC_OTA_UUID                                                  \
+    BLE_UUID128_INIT(0x40, 0x13, 0x3f, 0xff, 0x4e, 0xdc, 0xd2, 0xa3, 0xe8, \
+                     0x45, 0x5a, 0x1e, 0x5c, 0xa6, 0x5e, 0x0e);
+
+// 34 eb 77 95-2c 7f-40 0f-87 8d-ae f3 f7 98 99 d9
+// 34eb7795-2c7f-400f-878d-aef3f79899d9
+#define GATT_CHAR_OTA_CONTROL_UUID                                         \
+    BLE_UUID128_INIT(0xd9, 0x99, 0x98, 0xf7, 0xf3, 0xae, 0x8d, 0x87, 0x0f, \
+                     0x40, 0x7f, 0x2c, 0x95, 0x77, 0xeb, 0x34);
+
+// 63 74 75 38-89 8b-45 ad-a1 a0-a8 96 95 fb d1 e3
+// 63747538-898b-45ad-a1a0-a89695fbd1e3
+#define GATT_CHAR_OTA_DATA_UUID                                            \
+    BLE_UUID128_INIT(0xe3, 0xd1, 0xfb, 0x95, 0x96, 0xa8, 0xa0, 0xa1, 0xad, \
+                     0x45, 0x8b, 0x89, 0x38, 0x75, 0x74, 0x63);
+
+// fb 63 f9 79-35 ee-4e 30-9c 4f-ec 7a 67 0b 91 14
+// fb63f979-35ee-4e30-9c4f-ec7a670b9114
+#define GATT_CHAR_AUTO_BRIGHTNESS_UUID                                     \
+    BLE_UUID128_INIT(0x14, 0x91, 0x0b, 0x67, 0x7a, 0xec, 0x4f, 0x9c, 0x30, \
+                     0x4e, 0xee, 0x35, 0x79, 0xf9, 0x63, 0xfb);
+
+// be b8 d7 d8-80 b0-46 b4-ae 51-6b 04 27 ec 12 5a
+// beb8d7d8-80b0-46b4-ae51-6b0427ec125a
+#define GATT_CHAR_DIAGNOSTICS_UUID                                         \
+    BLE_UUID128_INIT(0x5a, 0x12, 0xec, 0x27, 0x04, 0x6b, 0x51, 0xae, 0xb4, \
+                     0x46, 0xb0, 0x80, 0xd8, 0xd7, 0xb8, 0xbe);
+
+// 44 b5 78 d2-bc a0-4e f3-87 9a-25 f9 bb e2 29 30
+// 44b578d2-bca0-4ef3-879a-25f9bbe22930
+#define GATT_CHAR_PWM_PROFILE_UUID                                         \
+    BLE_UUID128_INIT(0x30, 0x29, 0xe2, 0xbb, 0xf9, 0x25, 0x9a, 0x87, 0xf3, \
+                     0x4e, 0xa0, 0xbc, 0xd2, 0x78, 0xb5, 0x44);
+
+// 8a 15 37 ef-64 02-45 15-8f 23-a9 de fe f5 5e 0b
+// 8a1537ef-6402-4515-8f23-a9defef55e0b
+#define GATT_CHAR_GROUP_UUID                                               \
+    BLE_UUID128_INIT(0x0b, 0x5e, 0xf5, 0xfe, 0xde, 0xa9, 0x23, 0x8f, 0x15, \
+                     0x45, 0x02, 0x64, 0xef, 0x37, 0x15, 0x8a);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,95 @@
+/**
+ * @file ota.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief firmware update streamed over BLE
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The client writes begin_t to the control characteristic, then streams the
+ * image to the data characteristic with write without response. It may only
+ * send as many bytes as it was granted through credit_t notifications, the
+ * first grant comes right after begin. Once the image is sent it writes end,
+ * the result comes back as a done_t notification.
+ *
+ * Both characteristics need an encrypted link paired with the passkey of
+ * CONFIG_APP_OTA_PASSKEY. A new image boots on probation: unless it calls
+ * confirm() the bootloader goes back to the old one on the next reset.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ota {
+
+enum class op_t : uint8_t {
+    begin = 1,
+    end   = 2,
+    abort = 3,
+};
+
+enum class event_t : uint8_t {
+    credit = 0x80,
+    done   = 0x81,
+};
+
+struct __attribute__((packed)) begin_t {
+    op_t op;
+    uint32_t size;   // image size in bytes
+    uint32_t crc32;  // CRC-32 (zlib) of the whole image
+};
+
+struct __attribute__((packed)) credit_t {
+    event_t event;
+    uint32_t bytes;  // more bytes the client may send
+};
+
+struct __attribute__((packed)) done_t {
+    event_t event;
+    int32_t status;  // esp_err_t, ESP_OK boots the new image
+    uint32_t bytes;
+    uint32_t elapsed_ms;
+};
+
+struct stats_t {
+    uint32_t bytes;
+    uint32_t elapsed_ms;
+    uint32_t bytes_per_s;
+};
+
+/**
+ * @brief sends a notification on the control characteristic
+ */
+using notify_t = void (*)(const void *data, size_t len);
+
+void init(notify_t notify);
+
+/**
+ * @brief a write to the control characteristic
+ *
+ * @return false if the command is malformed or out of place
+ */
+bool control(const uint8_t *data, size_t len);
+
+/**
+ * @brief a write to the data characteristic
+ *
+ * @return false if no update is running or the client went past its credit,
+ * the update is aborted in that case
+ */
+bool write(const uint8_t *data, size_t len);
+
+/**
+ * @brief throughput of the last update
+ */
+stats_t get_stats();
+
+/**
+ * @brief the image running works, keep it; a no-op unless it is the first
+ * boot after an update
+ */
+void confirm();
+
+}  // namespace ota
@@ -0,0 +1,222 @@
+/**
+ * @file stream.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the image from the radio to the flash, no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The BLE host spends credit and cuts the stream into chunks with chunker_t,
+ * the writer task hands each chunk to writer_t, which checks the image on
+ * the way to the flash and grants the credit back. The flash itself is a
+ * template parameter, esp_ota_* on the device and a fake one on the host.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ota {
+
+// one flash sector per buffer, the radio fills one while the other is
+// erased and written
+constexpr size_t chunk_size   = 4096;
+constexpr uint8_t num_buffers = 2;
+
+/**
+ * @brief bytes the client may still send, spent by the BLE host and granted
+ * back by the writer
+ */
+class credits_t {
+public:
+    void reset() {
+        m_bytes = 0;
+    }
+
+    void grant(uint32_t bytes) {
+        m_bytes += bytes;
+    }
+
+    /**
+     * @return false, and nothing spent, if bytes is more than is left
+     */
+    bool spend(uint32_t bytes) {
+        uint32_t left = m_bytes.load();
+        do {
+            if(bytes > left) {
+                return false;
+            }
+        } while(!m_bytes.compare_exchange_weak(left, left - bytes));
+        return true;
+    }
+
+    uint32_t left() const {
+        return m_bytes.load();
+    }
+
+private:
+    std::atomic<uint32_t> m_bytes{0};
+};
+
+/**
+ * @brief fills the buffers in turn, a buffer is only handed out once full or
+ * at the end of the image
+ *
+ * Nothing here waits for a buffer to come back, the credit does that: no
+ * more than num_buffers * chunk_size is ever granted ahead of the writer, so
+ * the buffer filled next was written by the time the bytes for it arrive.
+ */
+class chunker_t {
+public:
+    void reset() {
+        m_fill     = 0;
+        m_fill_len = 0;
+    }
+
+    /**
+     * @brief copy the data in, submit(buffer, len) for each buffer filled
+     */
+    template <typename submit_t>
+    void push(const uint8_t *data, size_t len, submit_t submit) {
+        while(len > 0) {
+            const size_t n = std::min(len, chunk_size - m_fill_len);
+            memcpy(&m_buffers[m_fill][m_fill_len], data, n);
+            m_fill_len += n;
+            data += n;
+            len -= n;
+            if(m_fill_len == chunk_size) {
+                submit(m_fill, chunk_size);
+                m_fill     = (m_fill + 1) % num_buffers;
+                m_fill_len = 0;
+            }
+        }
+    }
+
+    /**
+     * @brief submit(buffer, len) for the tail of the image, if there is one
+     */
+    template <typename submit_t>
+    void flush(submit_t submit) {
+        if(m_fill_len > 0) {
+            submit(m_fill, m_fill_len);
+            m_fill_len = 0;
+        }
+    }
+
+    const uint8_t *buffer(uint8_t index) const {
+        return m_buffers[index];
+    }
+
+    /**
+     * @brief the buffer the next bytes go to
+     */
+    uint8_t filling() const {
+        return m_fill;
+    }
+
+private:
+    uint8_t m_buffers[num_buffers][chunk_size];
+    uint8_t m_fill    = 0;
+    size_t m_fill_len = 0;
+};
+
+/**
+ * @brief writes the chunks in order and checks size and CRC at the end, the
+ * flash is closed on any error so a new image can begin
+ *
+ * flash_t provides
+ *   - error_t begin(uint32_t size), error_t write(data, len), error_t end()
+ *   - static uint32_t crc32(uint32_t crc, data, len), zlib's CRC-32
+ *   - static constexpr error_t ok, invalid_size, invalid_crc
+ */
+template <typename flash_t>
+class writer_t {
+public:
+    using error_t = decltype(flash_t::ok);
+
+    explicit writer_t(flash_t &flash) : m_flash(flash) {}
+
+    error_t begin(uint32_t size, uint32_t crc32) {
+        abort();
+        m_size    = size;
+        m_crc32   = crc32;
+        m_written = 0;
+        m_crc     = 0;
+        error_t ret = m_flash.begin(size);
+        m_writing   = ret == flash_t::ok;
+        return ret;
+    }
+
+    error_t write(const uint8_t *data, size_t len) {
+        if(!m_writing) {
+            return flash_t::ok;
+        }
+        if(m_written + len > m_size) {
+            abort();
+            return flash_t::invalid_size;
+        }
+        error_t ret = m_flash.write(data, len);
+        if(ret != flash_t::ok) {
+            abort();
+            return ret;
+        }
+        m_crc = flash_t::crc32(m_crc, data, len);
+        m_written += len;
+        return flash_t::ok;
+    }
+
+    /**
+     * @return ok only if the whole image came and matches its CRC
+     */
+    error_t end() {
+        if(!m_writing) {
+            return flash_t::ok;
+        }
+        if(m_written != m_size) {
+            abort();
+            return flash_t::invalid_size;
+        }
+        if(m_crc != m_crc32) {
+            abort();
+            return flash_t::invalid_crc;
+        }
+        m_writing = false;
+        return m_flash.end();
+    }
+
+    /**
+     * @brief drop the image, also releases the flash when it is incomplete
+     */
+    void abort() {
+        if(m_writing) {
+            m_writing = false;
+            m_flash.end();
+        }
+    }
+
+    bool writing() const {
+        return m_writing;
+    }
+
+    uint32_t written() const {
+        return m_written;
+    }
+
+    uint32_t crc() const {
+        return m_crc;
+    }
+
+private:
+    flash_t &m_flash;
+    bool m_writing     = false;
+    uint32_t m_size    = 0;
+    uint32_t m_crc32   = 0;
+    uint32_t m_written = 0;
+    uint32_t m_crc     = 0;
+};
+
+}  // namespace ota
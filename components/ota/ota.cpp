@@ -0,0 +1,286 @@
+/**
+ * @file ota.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <atomic>
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp32/rom/crc.h"
+
+#include "ota.hpp"
+#include "stream.hpp"
+#include "board_configs.hpp"
+#include "static_alloc.hpp"
+
+namespace ota {
+
+namespace {
+
+constexpr auto TAG = "OTA";
+
+enum class command_t : uint8_t {
+    begin,
+    write,
+    end,
+    abort,
+};
+
+struct request_t {
+    command_t command;
+    uint8_t buffer;
+    uint16_t len;
+};
+
+/**
+ * @brief the next update partition through esp_ota_*
+ */
+class flash_t {
+public:
+    static constexpr esp_err_t ok           = ESP_OK;
+    static constexpr esp_err_t invalid_size = ESP_ERR_INVALID_SIZE;
+    static constexpr esp_err_t invalid_crc  = ESP_ERR_INVALID_CRC;
+
+    esp_err_t begin(uint32_t size) {
+        m_partition = esp_ota_get_next_update_partition(nullptr);
+        if(m_partition == nullptr) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if(size > m_partition->size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+#ifdef OTA_WITH_SEQUENTIAL_WRITES
+        // erase sector by sector as the data comes in
+        const size_t erase_size = OTA_WITH_SEQUENTIAL_WRITES;
+#else
+        const size_t erase_size = size;
+#endif
+        return esp_ota_begin(m_partition, erase_size, &m_handle);
+    }
+
+    esp_err_t write(const uint8_t *data, size_t len) {
+        return esp_ota_write(m_handle, data, len);
+    }
+
+    esp_err_t end() {
+        return esp_ota_end(m_handle);
+    }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t len) {
+        return crc32_le(crc, data, len);
+    }
+
+    const esp_partition_t *partition() const {
+        return m_partition;
+    }
+
+private:
+    const esp_partition_t *m_partition = nullptr;
+    esp_ota_handle_t m_handle          = 0;
+};
+
+// BLE host side
+std::atomic<bool> receiving{false};
+chunker_t chunker;
+begin_t image;
+credits_t credits;
+
+// writer side
+flash_t flash;
+writer_t<flash_t> writer(flash);
+int64_t start_us = 0;
+stats_t stats;
+
+static_alloc::task_t<4096> writer_task;
+static_alloc::queue_t<request_t, num_buffers + 2> requests_queue;
+QueueHandle_t q_requests = nullptr;
+notify_t notify          = nullptr;
+
+void grant(uint32_t bytes) {
+    credits.grant(bytes);
+    const credit_t event = {event_t::credit, bytes};
+    notify(&event, sizeof event);
+}
+
+bool submit(command_t command, uint8_t buffer = 0, uint16_t len = 0) {
+    const request_t request = {command, buffer, len};
+    return xQueueSend(q_requests, &request, 0) == pdTRUE;
+}
+
+void finish(esp_err_t status) {
+    const auto elapsed_ms
+        = static_cast<uint32_t>((esp_timer_get_time() - start_us) / 1000);
+    const uint32_t written = writer.written();
+    writer.abort();
+    receiving = false;
+
+    stats.bytes       = written;
+    stats.elapsed_ms  = elapsed_ms;
+    stats.bytes_per_s = elapsed_ms ? written * 1000ULL / elapsed_ms : 0;
+    ESP_LOGI(TAG, "%s: %u bytes in %u ms, %u B/s", esp_err_to_name(status),
+             stats.bytes, stats.elapsed_ms, stats.bytes_per_s);
+
+    const done_t event = {event_t::done, status, written, elapsed_ms};
+    notify(&event, sizeof event);
+}
+
+void do_begin() {
+    start_us      = esp_timer_get_time();
+    esp_err_t ret = writer.begin(image.size, image.crc32);
+    if(ret != ESP_OK) {
+        finish(ret);
+        return;
+    }
+    ESP_LOGI(TAG, "writing %u bytes to %s", image.size,
+             flash.partition()->label);
+    grant(num_buffers * chunk_size);
+}
+
+void do_write(const request_t &request) {
+    if(!writer.writing()) {
+        return;
+    }
+    esp_err_t ret = writer.write(chunker.buffer(request.buffer), request.len);
+    if(ret != ESP_OK) {
+        finish(ret);
+        return;
+    }
+    grant(request.len);
+}
+
+void do_end() {
+    if(!writer.writing()) {
+        return;
+    }
+    const uint32_t crc = writer.crc();
+    esp_err_t ret      = writer.end();
+    if(ret == ESP_ERR_INVALID_CRC) {
+        ESP_LOGE(TAG, "crc mismatch: %08x != %08x", crc, image.crc32);
+    }
+    if(ret == ESP_OK) {
+        ret = esp_ota_set_boot_partition(flash.partition());
+    }
+    finish(ret);
+    if(ret == ESP_OK) {
+        // give the notification time to go out
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
+}
+
+void task(void *ignore) {
+    while(true) {
+        request_t request;
+        xQueueReceive(q_requests, &request, portMAX_DELAY);
+        switch(request.command) {
+            case command_t::begin:
+                do_begin();
+                break;
+            case command_t::write:
+                do_write(request);
+                break;
+            case command_t::end:
+                do_end();
+                break;
+            case command_t::abort:
+                if(writer.writing()) {
+                    finish(ESP_FAIL);
+                }
+                break;
+        }
+    }
+}
+
+}  // namespace
+
+
+bool control(const uint8_t *data, size_t len) {
+    if(len == 0) {
+        return false;
+    }
+    switch(static_cast<op_t>(data[0])) {
+        case op_t::begin:
+            if(len != sizeof image || receiving) {
+                return false;
+            }
+            memcpy(&image, data, sizeof image);
+            chunker.reset();
+            credits.reset();
+            receiving = true;
+            return submit(command_t::begin);
+
+        case op_t::end:
+            if(!receiving) {
+                return false;
+            }
+            receiving = false;
+            chunker.flush([](uint8_t buffer, size_t len) {
+                submit(command_t::write, buffer, len);
+            });
+            return submit(command_t::end);
+
+        case op_t::abort:
+            receiving = false;
+            return submit(command_t::abort);
+    }
+    return false;
+}
+
+bool write(const uint8_t *data, size_t len) {
+    if(!receiving) {
+        return false;
+    }
+    if(!credits.spend(len)) {
+        ESP_LOGE(TAG, "client went past its credit");
+        receiving = false;
+        submit(command_t::abort);
+        return false;
+    }
+
+    chunker.push(data, len, [](uint8_t buffer, size_t len) {
+        submit(command_t::write, buffer, len);
+    });
+    return true;
+}
+
+stats_t get_stats() {
+    return stats;
+}
+
+void confirm() {
+    esp_ota_img_states_t state;
+    const auto *running = esp_ota_get_running_partition();
+    if(esp_ota_get_state_partition(running, &state) != ESP_OK
+       || state != ESP_OTA_IMG_PENDING_VERIFY) {
+        return;
+    }
+    ESP_ERROR_CHECK(esp_ota_mark_app_valid_cancel_rollback());
+    ESP_LOGI(TAG, "image confirmed, no rollback");
+}
+
+void init(notify_t notify_cb) {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    notify     = notify_cb;
+    q_requests = requests_queue.create("otaRequests");
+    writer_task.create(task, "otaWriter", board_configs::default_task_priority,
+                       APP_CPU_NUM);
+}
+
+}  // namespace ota
@@ -0,0 +1,44 @@
+/**
+ * @file powerfail.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief saves the brightness when the supply goes away
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace powerfail {
+
+struct stats_t {
+    uint32_t count;    // records written with their latency
+    uint32_t last_us;  // interrupt to durable write
+    uint32_t max_us;
+};
+
+/**
+ * @brief move a record left by the last power failure into the storage and
+ * erase the sector for the next one
+ *
+ * @note call after storage::init() and before leds::init()
+ */
+void restore();
+
+/**
+ * @brief arm the supply sense interrupt
+ *
+ * @note call after leds::init(), what leds holds is what gets saved
+ */
+void init();
+
+/**
+ * @brief every failure so far, each boot adds the latencies the one before
+ * left in flash to the storage
+ */
+stats_t get_stats();
+
+}  // namespace powerfail
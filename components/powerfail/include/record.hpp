@@ -0,0 +1,144 @@
+/**
+ * @file record.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the words written when the power fails, no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "powerfail.hpp"
+
+namespace powerfail {
+
+/**
+ * @brief every word is programmed over an erased one and carries a Berger
+ * code: [31:24] magic, [23:8] payload, [7:5] left at 1, [4:0] the number of
+ * 0 bits in [31:8]
+ *
+ * Programming only takes bits from 1 to 0, a write torn by the power going
+ * away leaves some of them at 1. That lowers the zero count of [31:8] and
+ * can only raise the count in [4:0], so the two never agree on a torn word.
+ * Programming 0 over a whole record to drop it works the same way the other
+ * way around, torn or not it no longer decodes.
+ *
+ * A failure takes a pair of slots, the record with the brightness and then
+ * the latency of that record.
+ */
+constexpr uint32_t erased_word  = 0xffffffff;
+constexpr uint32_t dropped_word = 0;
+constexpr uint8_t record_magic  = 0x5a;
+constexpr uint8_t latency_magic = 0xa6;
+constexpr size_t words_per_slot = 2;
+
+constexpr uint8_t count_zeros(uint32_t data) {
+    uint8_t zeros = 0;
+    for(int i = 0; i < 24; ++i) {
+        zeros += !((data >> i) & 1);
+    }
+    return zeros;
+}
+
+constexpr uint32_t encode_word(uint8_t magic, uint16_t payload) {
+    const uint32_t data = static_cast<uint32_t>(magic) << 16 | payload;
+    return data << 8 | 0xe0 | count_zeros(data);
+}
+
+/**
+ * @return false if the word is erased, torn, dropped or another kind
+ */
+constexpr bool decode_word(uint32_t word, uint8_t magic, uint16_t &payload) {
+    const uint32_t data = word >> 8;
+    payload             = data & 0xffff;
+    return (data >> 16) == magic && (word & 0xe0) == 0xe0
+           && (word & 0x1f) == count_zeros(data);
+}
+
+constexpr uint32_t encode(uint8_t ch0, uint8_t ch1) {
+    return encode_word(record_magic, static_cast<uint16_t>(ch1 << 8 | ch0));
+}
+
+constexpr bool decode(uint32_t word, uint8_t (&bris)[2]) {
+    uint16_t payload = 0;
+    const bool ok    = decode_word(word, record_magic, payload);
+    bris[0]          = payload & 0xff;
+    bris[1]          = payload >> 8;
+    return ok;
+}
+
+/**
+ * @brief interrupt to durable record, saturated at 16 bit
+ */
+constexpr uint32_t encode_latency(uint32_t latency_us) {
+    return encode_word(latency_magic, latency_us > 0xffff
+                                          ? 0xffff
+                                          : static_cast<uint16_t>(latency_us));
+}
+
+/**
+ * @brief walks the partition word by word at boot, the last record that
+ * decodes wins and every latency that decodes counts
+ */
+class scanner_t {
+public:
+    void feed(uint32_t word) {
+        m_written |= word != erased_word;
+        if(m_position++ % words_per_slot == 0) {
+            uint8_t bris[2];
+            if(decode(word, bris)) {
+                m_bris[0] = bris[0];
+                m_bris[1] = bris[1];
+                m_found   = true;
+            }
+            return;
+        }
+        uint16_t latency_us = 0;
+        if(decode_word(word, latency_magic, latency_us)) {
+            m_stats.count++;
+            m_stats.last_us = latency_us;
+            if(latency_us > m_stats.max_us) {
+                m_stats.max_us = latency_us;
+            }
+        }
+    }
+
+    /**
+     * @brief a record to restore, in bris
+     */
+    bool found() const {
+        return m_found;
+    }
+
+    const uint8_t (&bris() const)[2] {
+        return m_bris;
+    }
+
+    /**
+     * @brief anything but erased words, the partition needs an erase
+     */
+    bool written() const {
+        return m_written;
+    }
+
+    /**
+     * @brief the failures of the last boot, count is the latencies found
+     */
+    const stats_t &stats() const {
+        return m_stats;
+    }
+
+private:
+    size_t m_position = 0;
+    bool m_found      = false;
+    bool m_written    = false;
+    uint8_t m_bris[2] = {0};
+    stats_t m_stats   = {};
+};
+
+}  // namespace powerfail
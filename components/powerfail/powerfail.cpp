@@ -0,0 +1,199 @@
+/**
+ * @file powerfail.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include "powerfail.hpp"
+#include "record.hpp"
+#include "board_configs.hpp"
+#include "leds.hpp"
+#include "static_alloc.hpp"
+#include "storage.hpp"
+
+namespace powerfail {
+
+namespace {
+
+constexpr auto TAG             = "POWERFAIL";
+constexpr auto *partition_name = "powerfail";
+constexpr auto *nvkey          = "pfstats";
+constexpr size_t scan_words    = 64;
+
+static_assert(scan_words % words_per_slot == 0, "a read splits a slot");
+
+const esp_partition_t *partition = nullptr;
+size_t num_slots                 = 0;
+
+// taken by the save task, and dropped up to by a persist on the event loop
+std::atomic<size_t> next_slot{0};
+std::atomic<size_t> first_live{0};
+
+// what the storage holds from the failures before this boot, and the ones
+// since then on top
+stats_t stats = {};
+
+static_alloc::task_t<configMINIMAL_STACK_SIZE * 3> save_task;
+TaskHandle_t task_handle = nullptr;
+
+size_t slot_offset(size_t slot) {
+    return slot * words_per_slot * sizeof(uint32_t);
+}
+
+void IRAM_ATTR on_supply_drop(void *ignore) {
+    // the value is the time of the first edge, the bounces after it do not
+    // overwrite it until the task took it
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(task_handle,
+                       static_cast<uint32_t>(esp_timer_get_time()),
+                       eSetValueWithoutOverwrite, &woken);
+    if(woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void task(void *ignore) {
+    while(true) {
+        uint32_t isr_us = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &isr_us, portMAX_DELAY);
+        // nothing is logged on this path, the UART would eat the hold-up time
+        const size_t slot = next_slot;
+        if(slot >= num_slots) {
+            continue;
+        }
+        const uint32_t word = encode(leds::get_brightness(leds::channel0),
+                                     leds::get_brightness(leds::channel1));
+        esp_err_t ret = esp_partition_write(partition, slot_offset(slot),
+                                            &word, sizeof word);
+        // 32 bit wraps in an hour, far longer than any write
+        const uint32_t latency_us
+            = static_cast<uint32_t>(esp_timer_get_time()) - isr_us;
+        next_slot = slot + 1;
+        if(ret != ESP_OK) {
+            continue;
+        }
+
+        // the record is durable, the latency goes next to it for the boot
+        // after to collect
+        const uint32_t latency = encode_latency(latency_us);
+        esp_partition_write(partition, slot_offset(slot) + sizeof word,
+                            &latency, sizeof latency);
+        stats.last_us = latency_us;
+        if(latency_us > stats.max_us) {
+            stats.max_us = latency_us;
+        }
+        stats.count++;
+    }
+}
+
+/**
+ * @brief the storage is up to date, a record the supply left on a glitch
+ * it survived holds an older value now and must not be restored
+ */
+void on_persist() {
+    const size_t end = next_slot;
+    for(size_t slot = first_live; slot < end; ++slot) {
+        const uint32_t word = dropped_word;
+        esp_partition_write(partition, slot_offset(slot), &word, sizeof word);
+    }
+    first_live = end;
+}
+
+}  // namespace
+
+
+void restore() {
+    size_t size = sizeof stats;
+    storage::get_blob(nvkey, &stats, size);
+
+    partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_name);
+    if(partition == nullptr) {
+        ESP_LOGE(TAG, "no %s partition", partition_name);
+        return;
+    }
+    num_slots = partition->size / slot_offset(1);
+
+    // the last complete record wins, torn and dropped ones are skipped
+    scanner_t scanner;
+    uint32_t words[scan_words];
+    const size_t num_words = num_slots * words_per_slot;
+    for(size_t i = 0; i < num_words; i += scan_words) {
+        ESP_ERROR_CHECK(esp_partition_read(partition, i * sizeof(uint32_t),
+                                           words, sizeof words));
+        for(const auto word : words) {
+            scanner.feed(word);
+        }
+    }
+
+    if(scanner.found()) {
+        ESP_LOGI(TAG, "restoring brightness: %03u, %03u", scanner.bris()[0],
+                 scanner.bris()[1]);
+        storage::set_values(scanner.bris());
+    }
+    const auto &last_boot = scanner.stats();
+    if(last_boot.count > 0) {
+        stats.count += last_boot.count;
+        stats.last_us = last_boot.last_us;
+        if(last_boot.max_us > stats.max_us) {
+            stats.max_us = last_boot.max_us;
+        }
+        storage::set_blob(nvkey, &stats, sizeof stats);
+        ESP_LOGI(TAG, "%u records so far, last %u us, max %u us",
+                 stats.count, stats.last_us, stats.max_us);
+    }
+    // pre-erased, so a failure only has to program a word
+    if(scanner.written()) {
+        ESP_ERROR_CHECK(
+            esp_partition_erase_range(partition, 0, partition->size));
+    }
+    next_slot  = 0;
+    first_live = 0;
+}
+
+stats_t get_stats() {
+    return stats;
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized || partition == nullptr) {
+        return;
+    }
+    initialized = true;
+
+    task_handle = save_task.create(task, "powerFail", configMAX_PRIORITIES - 1,
+                                   APP_CPU_NUM);
+    leds::set_persist_hook(on_persist);
+
+    const gpio_config_t sense_conf = {
+        .pin_bit_mask = 1ULL << board_configs::GPIO_POWER_SENSE,
+        .mode         = GPIO_MODE_INPUT,
+        .pull_up_en   = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type    = GPIO_INTR_NEGEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&sense_conf));
+    esp_err_t ret = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if(ret != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(ret);
+    }
+    ESP_ERROR_CHECK(gpio_isr_handler_add(board_configs::GPIO_POWER_SENSE,
+                                         on_supply_drop, nullptr));
+}
+
+}  // namespace powerfail
@@ -0,0 +1,65 @@
+/**
+ * @file scheduler.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "leds.hpp"
+
+namespace scheduler {
+
+constexpr size_t max_entries = 32;
+
+/**
+ * @brief one schedule entry, this is also the format written over BLE and
+ * stored in the storage partition
+ */
+struct __attribute__((packed)) entry_t {
+    uint8_t days;     // bit 0 == sunday ... bit 6 == saturday
+    uint16_t minute;  // minute of the day [0-1439] the target is reached
+    leds::channel_t channel;
+    uint8_t brightness;    // target [0-100]
+    uint8_t ramp_minutes;  // 0 == switch at once
+};
+
+static_assert(sizeof(entry_t) == 6, "entry_t is part of the BLE protocol");
+
+/**
+ * @brief load the saved schedule and arm the timer for the next deadline
+ */
+void init();
+
+/**
+ * @brief replace the schedule and save it
+ *
+ * @return false if there are too many entries or one is not valid, the
+ * schedule stays as it was
+ */
+bool set_entries(const entry_t *entries, size_t count);
+
+/**
+ * @brief copy the schedule, returns the number of entries copied
+ */
+size_t get_entries(entry_t (&entries)[max_entries]);
+
+/**
+ * @brief stop a running ramp, the channel was set by someone else
+ */
+void cancel_ramp(leds::channel_t channel);
+
+/**
+ * @brief set the wall clock, in local time seconds since the epoch, the
+ * schedule does not fire while the clock is not set
+ */
+void set_time(uint32_t local_epoch);
+
+}  // namespace scheduler
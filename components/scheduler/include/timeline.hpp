@@ -0,0 +1,180 @@
+/**
+ * @file timeline.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief when each schedule entry fires next, no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "scheduler.hpp"
+
+namespace scheduler {
+
+constexpr uint16_t minutes_per_day = 24 * 60;
+constexpr uint8_t every_day        = 0x7f;
+
+// anything before 2021-01-01 is a clock that was never set
+constexpr time_t min_valid_epoch = 1609459200;
+constexpr time_t day_in_seconds  = 24 * 60 * 60;
+
+/**
+ * @brief false for an entry that would never fire or fire on garbage, the
+ * ones coming over BLE or from the storage are checked with this
+ */
+constexpr bool is_valid(const entry_t &entry) {
+    return entry.days != 0 && (entry.days & ~every_day) == 0
+           && entry.minute < minutes_per_day && leds::is_valid(entry.channel)
+           && entry.brightness <= 100;
+}
+
+/**
+ * @brief first time after now the entry starts, that is its minute minus
+ * the ramp, which may fall on the day before
+ *
+ * @return 0 if it never does
+ */
+inline time_t next_start(const entry_t &entry, time_t now) {
+    tm local;
+    localtime_r(&now, &local);
+    const time_t midnight
+        = now - (local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+    const time_t start = entry.minute * 60 - entry.ramp_minutes * 60;
+
+    // a ramp may start the day before its minute, the same weekday a week
+    // later can be 8 midnights away then
+    for(int day = 0; day <= 8; ++day) {
+        const int wday = (local.tm_wday + day) % 7;
+        const time_t t = midnight + day * day_in_seconds + start;
+        if((entry.days & (1U << wday)) && t > now) {
+            return t;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief the entries ordered by their next start in a binary heap, a tick
+ * only touches the entries that are due, and the next deadline is the top
+ *
+ * The entries themselves stay with the caller, the heap holds their index.
+ */
+template <size_t capacity>
+class timeline_t {
+public:
+    /**
+     * @brief start over with count entries, a clock that is not set yet
+     * leaves the timeline empty
+     */
+    void load(const entry_t *entries, size_t count, time_t now) {
+        m_size = 0;
+        m_work = 0;
+        if(now < min_valid_epoch) {
+            return;
+        }
+        for(size_t i = 0; i < count && i < capacity; ++i) {
+            push({next_start(entries[i], now), static_cast<uint16_t>(i)});
+        }
+    }
+
+    void clear() {
+        m_size = 0;
+    }
+
+    /**
+     * @brief call fire(index) for every entry due by now, each goes back in
+     * at its next start
+     */
+    template <typename fire_t>
+    size_t fire_due(const entry_t *entries, time_t now, fire_t fire) {
+        m_work      = 0;
+        size_t done = 0;
+        while(m_size > 0 && m_heap[0].at <= now) {
+            const uint16_t index = m_heap[0].index;
+            pop();
+            fire(index);
+            push({next_start(entries[index], now), index});
+            ++done;
+        }
+        return done;
+    }
+
+    /**
+     * @return the earliest start, 0 if there is none
+     */
+    time_t next() const {
+        return m_size > 0 ? m_heap[0].at : 0;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    /**
+     * @brief heap levels walked by the last load or fire_due, the cost of a
+     * tick whatever the clock of the machine
+     */
+    size_t work() const {
+        return m_work;
+    }
+
+private:
+    struct slot_t {
+        time_t at;
+        uint16_t index;
+    };
+
+    static_assert(capacity <= UINT16_MAX, "the index is 16 bit");
+
+    void push(slot_t slot) {
+        // an entry without a day to fire on is left out
+        if(slot.at == 0) {
+            return;
+        }
+        size_t i = m_size++;
+        while(i > 0) {
+            const size_t parent = (i - 1) / 2;
+            ++m_work;
+            if(m_heap[parent].at <= slot.at) {
+                break;
+            }
+            m_heap[i] = m_heap[parent];
+            i         = parent;
+        }
+        m_heap[i] = slot;
+    }
+
+    void pop() {
+        const slot_t last = m_heap[--m_size];
+        size_t i          = 0;
+        while(true) {
+            size_t child = 2 * i + 1;
+            if(child >= m_size) {
+                break;
+            }
+            ++m_work;
+            if(child + 1 < m_size && m_heap[child + 1].at < m_heap[child].at) {
+                ++child;
+            }
+            if(last.at <= m_heap[child].at) {
+                break;
+            }
+            m_heap[i] = m_heap[child];
+            i         = child;
+        }
+        m_heap[i] = last;
+    }
+
+    slot_t m_heap[capacity];
+    size_t m_size = 0;
+    size_t m_work = 0;
+};
+
+}  // namespace scheduler
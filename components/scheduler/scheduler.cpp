@@ -0,0 +1,244 @@
+/**
+ * @file scheduler.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "scheduler.hpp"
+#include "timeline.hpp"
+#include "event_loop.hpp"
+#include "static_alloc.hpp"
+#include "storage.hpp"
+
+namespace scheduler {
+
+namespace {
+
+constexpr auto TAG    = "SCHEDULER";
+constexpr auto *nvkey = "schedule";
+
+constexpr int64_t us_per_second = 1000 * 1000;
+constexpr uint8_t num_channels  = 2;
+
+struct ramp_t {
+    bool active;
+    uint8_t from;
+    uint8_t to;
+    uint8_t last;
+    int64_t start_us;
+    int64_t duration_us;
+};
+
+entry_t entries[max_entries];
+size_t num_entries = 0;
+timeline_t<max_entries> timeline;
+ramp_t ramps[num_channels];
+
+esp_timer_handle_t timer = nullptr;
+static_alloc::mutex_t scheduler_mutex;
+SemaphoreHandle_t mutex  = nullptr;
+
+int64_t wall_time_us() {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * us_per_second + tv.tv_usec;
+}
+
+void recompute(time_t now) {
+    timeline.load(entries, num_entries, now);
+}
+
+void start_ramp(const entry_t &entry, int64_t now_us) {
+    auto &ramp = ramps[entry.channel == leds::channel0 ? 0 : 1];
+    const uint8_t from = leds::get_brightness(entry.channel);
+
+    if(entry.ramp_minutes == 0 || from == entry.brightness) {
+        ramp.active = false;
+        leds::push_message({entry.channel, entry.brightness});
+        return;
+    }
+    ramp.active      = true;
+    ramp.from        = from;
+    ramp.to          = entry.brightness;
+    ramp.last        = from;
+    ramp.start_us    = now_us;
+    ramp.duration_us = entry.ramp_minutes * 60 * us_per_second;
+}
+
+void step_ramps(int64_t now_us) {
+    for(uint8_t ch = 0; ch < num_channels; ++ch) {
+        auto &ramp = ramps[ch];
+        if(!ramp.active) {
+            continue;
+        }
+        const int64_t elapsed = now_us - ramp.start_us;
+        uint8_t value         = ramp.to;
+        if(elapsed < ramp.duration_us) {
+            value = ramp.from
+                    + (ramp.to - ramp.from) * elapsed / ramp.duration_us;
+        }
+        else {
+            ramp.active = false;
+        }
+        if(value != ramp.last) {
+            ramp.last = value;
+            leds::push_message({ch == 0 ? leds::channel0 : leds::channel1,
+                                value});
+        }
+    }
+}
+
+/**
+ * @brief when the ramp value changes by one step again
+ */
+int64_t next_ramp_step(const ramp_t &ramp) {
+    const int diff = ramp.to > ramp.from ? ramp.to - ramp.from
+                                         : ramp.from - ramp.to;
+    const int done = ramp.last > ramp.from ? ramp.last - ramp.from
+                                           : ramp.from - ramp.last;
+    return ramp.start_us + ramp.duration_us * (done + 1) / diff;
+}
+
+/**
+ * @brief arm the one shot timer to the nearest deadline, call with the mutex
+ * held
+ */
+void arm() {
+    esp_timer_stop(timer);
+
+    const int64_t now_us  = esp_timer_get_time();
+    const int64_t wall_us = wall_time_us();
+    int64_t deadline_us   = INT64_MAX;
+    if(timeline.next() != 0) {
+        deadline_us = now_us + timeline.next() * us_per_second - wall_us;
+    }
+    for(const auto &ramp : ramps) {
+        if(ramp.active) {
+            deadline_us = std::min(deadline_us, next_ramp_step(ramp));
+        }
+    }
+
+    if(deadline_us != INT64_MAX) {
+        const int64_t timeout_us = std::max<int64_t>(deadline_us - now_us, 1);
+        ESP_ERROR_CHECK(esp_timer_start_once(timer, timeout_us));
+    }
+}
+
+void on_timer(void *ignore) {
+    event_loop::post(event_loop::scheduler_tick);
+}
+
+void tick() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const int64_t now_us = esp_timer_get_time();
+    const time_t now     = time(nullptr);
+    timeline.fire_due(entries, now, [now_us](size_t i) {
+        ESP_LOGI(TAG, "entry %u: ch: %u, bri: %03u, ramp: %u min", i,
+                 entries[i].channel, entries[i].brightness,
+                 entries[i].ramp_minutes);
+        start_ramp(entries[i], now_us);
+    });
+    step_ramps(now_us);
+    arm();
+    xSemaphoreGive(mutex);
+}
+
+}  // namespace
+
+
+bool set_entries(const entry_t *new_entries, size_t count) {
+    if(count > max_entries) {
+        return false;
+    }
+    for(size_t i = 0; i < count; ++i) {
+        if(!is_valid(new_entries[i])) {
+            ESP_LOGW(TAG, "entry %u is not valid", i);
+            return false;
+        }
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memcpy(entries, new_entries, count * sizeof(entry_t));
+    num_entries = count;
+    recompute(time(nullptr));
+    arm();
+    xSemaphoreGive(mutex);
+
+    ESP_LOGI(TAG, "got %u entries", count);
+    storage::set_blob(nvkey, new_entries, count * sizeof(entry_t));
+    return true;
+}
+
+size_t get_entries(entry_t (&out)[max_entries]) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const size_t count = num_entries;
+    memcpy(out, entries, count * sizeof(entry_t));
+    xSemaphoreGive(mutex);
+    return count;
+}
+
+void cancel_ramp(leds::channel_t channel) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    ramps[channel == leds::channel0 ? 0 : 1].active = false;
+    xSemaphoreGive(mutex);
+}
+
+void set_time(uint32_t local_epoch) {
+    const timeval tv = {static_cast<time_t>(local_epoch), 0};
+    settimeofday(&tv, nullptr);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    recompute(tv.tv_sec);
+    arm();
+    xSemaphoreGive(mutex);
+    ESP_LOGI(TAG, "clock set to %u", local_epoch);
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    mutex = scheduler_mutex.create("scheduler");
+    const esp_timer_create_args_t timer_args = {
+        .callback        = on_timer,
+        .arg             = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "scheduler",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    event_loop::set_handler(event_loop::scheduler_tick, tick);
+
+    size_t size = sizeof entries;
+    if(storage::get_blob(nvkey, entries, size)) {
+        // saved by an older firmware, maybe, keep only what is valid now
+        for(size_t i = 0; i < size / sizeof(entry_t); ++i) {
+            if(is_valid(entries[i])) {
+                entries[num_entries++] = entries[i];
+            }
+        }
+        ESP_LOGI(TAG, "got %u saved entries", num_entries);
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    recompute(time(nullptr));
+    arm();
+    xSemaphoreGive(mutex);
+}
+
+}  // namespace scheduler
@@ -0,0 +1,122 @@
+/**
+ * @file static_alloc.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief storage for the app tasks and queues, static when
+ * CONFIG_APP_STATIC_ALLOCATION is set and from the heap otherwise
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace static_alloc {
+
+/**
+ * @brief record an allocation for the boot report, a task also gets the
+ * least stack it had left
+ */
+void track(const char *name, size_t bytes, bool is_static,
+           TaskHandle_t task = nullptr);
+
+/**
+ * @brief log every allocation tracked, the stack left of the tasks and the
+ * state of the heap
+ */
+void report();
+
+/**
+ * @brief a task, stack_size is in bytes like everywhere in ESP-IDF
+ */
+template <uint32_t stack_size>
+class task_t {
+public:
+    TaskHandle_t create(TaskFunction_t function, const char *name,
+                        UBaseType_t priority, BaseType_t core,
+                        void *arg = nullptr) {
+#if CONFIG_APP_STATIC_ALLOCATION
+        m_handle = xTaskCreateStaticPinnedToCore(
+            function, name, stack_size, arg, priority, m_stack, &m_tcb, core);
+        track(name, sizeof m_stack + sizeof m_tcb, true, m_handle);
+#else
+        xTaskCreatePinnedToCore(function, name, stack_size, arg, priority,
+                                &m_handle, core);
+        track(name, stack_size + sizeof(StaticTask_t), false, m_handle);
+#endif
+        return m_handle;
+    }
+
+    TaskHandle_t handle() const {
+        return m_handle;
+    }
+
+private:
+    TaskHandle_t m_handle = nullptr;
+#if CONFIG_APP_STATIC_ALLOCATION
+    StackType_t m_stack[stack_size / sizeof(StackType_t)];
+    StaticTask_t m_tcb;
+#endif
+};
+
+template <typename item_t, UBaseType_t length>
+class queue_t {
+public:
+    QueueHandle_t create(const char *name) {
+#if CONFIG_APP_STATIC_ALLOCATION
+        m_handle = xQueueCreateStatic(length, sizeof(item_t), m_storage,
+                                      &m_queue);
+        track(name, sizeof m_storage + sizeof m_queue, true);
+#else
+        m_handle = xQueueCreate(length, sizeof(item_t));
+        track(name, length * sizeof(item_t) + sizeof(StaticQueue_t), false);
+#endif
+        return m_handle;
+    }
+
+    QueueHandle_t handle() const {
+        return m_handle;
+    }
+
+private:
+    QueueHandle_t m_handle = nullptr;
+#if CONFIG_APP_STATIC_ALLOCATION
+    uint8_t m_storage[length * sizeof(item_t)];
+    StaticQueue_t m_queue;
+#endif
+};
+
+class mutex_t {
+public:
+    SemaphoreHandle_t create(const char *name) {
+#if CONFIG_APP_STATIC_ALLOCATION
+        m_handle = xSemaphoreCreateMutexStatic(&m_mutex);
+        track(name, sizeof m_mutex, true);
+#else
+        m_handle = xSemaphoreCreateMutex();
+        track(name, sizeof(StaticSemaphore_t), false);
+#endif
+        return m_handle;
+    }
+
+    SemaphoreHandle_t handle() const {
+        return m_handle;
+    }
+
+private:
+    SemaphoreHandle_t m_handle = nullptr;
+#if CONFIG_APP_STATIC_ALLOCATION
+    StaticSemaphore_t m_mutex;
+#endif
+};
+
+}  // namespace static_alloc
@@ -0,0 +1,73 @@
+/**
+ * @file static_alloc.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "static_alloc.hpp"
+
+namespace static_alloc {
+
+namespace {
+
+constexpr auto TAG = "STATIC_ALLOC";
+
+constexpr size_t max_records = 16;
+
+struct record_t {
+    const char *name;
+    size_t bytes;
+    bool is_static;
+    TaskHandle_t task;
+};
+
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+record_t records[max_records];
+size_t num_records = 0;
+
+}  // namespace
+
+
+void track(const char *name, size_t bytes, bool is_static,
+           TaskHandle_t task) {
+    portENTER_CRITICAL(&lock);
+    if(num_records < max_records) {
+        records[num_records++] = {name, bytes, is_static, task};
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void report() {
+    size_t static_bytes = 0;
+    size_t heap_bytes   = 0;
+    for(size_t i = 0; i < num_records; ++i) {
+        const auto &record = records[i];
+        const char *kind = record.is_static ? "static" : "heap";
+        if(record.task != nullptr) {
+            // in bytes on the ESP32, the least since the task started
+            ESP_LOGI(TAG, "%-12s %6u bytes %s, %u stack left", record.name,
+                     record.bytes, kind,
+                     uxTaskGetStackHighWaterMark(record.task));
+        }
+        else {
+            ESP_LOGI(TAG, "%-12s %6u bytes %s", record.name, record.bytes,
+                     kind);
+        }
+        (record.is_static ? static_bytes : heap_bytes) += record.bytes;
+    }
+    ESP_LOGI(TAG, "app: %u bytes static, %u bytes heap", static_bytes,
+             heap_bytes);
+    ESP_LOGI(TAG, "heap: %u free, %u minimum free, %u largest block",
+             heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+}  // namespace static_alloc
@@ -10,6 +10,9 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace storage {
 
 void init();
@@ -18,4 +21,19 @@ void get_values(uint8_t (&bris)[2]);
 
 void set_values(const uint8_t (&bris)[2]);
 
+/**
+ * @brief read a blob from the storage partition
+ *
+ * @param key
+ * @param data
+ * @param size in: the size of data, out: the size of the blob read
+ * @return false if there is no such blob or it does not fit in data
+ */
+bool get_blob(const char *key, void *data, size_t &size);
+
+/**
+ * @brief write a blob to the storage partition, only commits on change
+ */
+void set_blob(const char *key, const void *data, size_t size);
+
 }  // namespace storage
\ No newline at end of file
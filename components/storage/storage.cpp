@@ -24,6 +24,8 @@ namespace {
 constexpr auto *TAG   = "STORAGE";
 constexpr auto *nvkey = "storage";
 
+constexpr size_t max_compare_size = 256;
+
 static void flash_init() {
     auto res = nvs_flash_init();
     if(res == ESP_ERR_NVS_NO_FREE_PAGES
@@ -75,6 +77,44 @@ void set_values(const uint8_t (&bris)[2]) {
     nvs_close(nvhandle);
 }
 
+bool get_blob(const char *key, void *data, size_t &size) {
+    nvs_handle_t nvhandle;
+    esp_err_t ret;
+    ESP_ERROR_CHECK(
+        ret = nvs_open_from_partition(
+            nvkey, nvkey, nvs_open_mode_t::NVS_READWRITE, &nvhandle));
+    ret = nvs_get_blob(nvhandle, key, data, &size);
+    nvs_close(nvhandle);
+    if(ret != ESP_OK) {
+        size = 0;
+        return false;
+    }
+    return true;
+}
+
+void set_blob(const char *key, const void *data, size_t size) {
+    nvs_handle_t nvhandle;
+    esp_err_t ret;
+    ESP_ERROR_CHECK(
+        ret = nvs_open_from_partition(
+            nvkey, nvkey, nvs_open_mode_t::NVS_READWRITE, &nvhandle));
+    size_t old_size = 0;
+    ret = nvs_get_blob(nvhandle, key, nullptr, &old_size);
+    // blobs too big to compare on the stack are always rewritten
+    bool changed = ret != ESP_OK || old_size != size || size > max_compare_size;
+    if(!changed && size > 0) {
+        uint8_t old[max_compare_size];
+        ret     = nvs_get_blob(nvhandle, key, old, &old_size);
+        changed = ret != ESP_OK || memcmp(old, data, size) != 0;
+    }
+    if(changed) {
+        ESP_ERROR_CHECK(ret = nvs_set_blob(nvhandle, key, data, size));
+        ESP_ERROR_CHECK(ret = nvs_commit(nvhandle));
+        ESP_LOGI(TAG, "blob %s set, %u bytes", key, size);
+    }
+    nvs_close(nvhandle);
+}
+
 void init() {
     static bool initialized = false;
     if(initialized) {
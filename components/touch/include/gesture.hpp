@@ -0,0 +1,147 @@
+/**
+ * @file gesture.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief tap, long press and slide over two touch pads, no IDF in here
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace touch {
+
+constexpr uint8_t num_pads = 2;
+
+constexpr uint32_t long_press_ms = 400;  // held longer is no tap anymore
+constexpr uint32_t hold_step_ms  = 50;   // a dimming step while held
+constexpr uint32_t slide_ms      = 300;  // the other pad has to come by then
+// a finger sliding across may leave one pad before it reaches the other, a
+// tap is only told once nothing came for this long
+constexpr uint32_t slide_gap_ms = 60;
+
+enum action_t : uint8_t {
+    none = 0,
+    press,       // on the first sample of a touch, whatever it turns into
+    tap,         // pad touched and let go
+    hold_start,  // pad held past long_press_ms
+    hold_step,   // every hold_step_ms after that, until it is let go
+    slide,       // from pad to the other one, touching or with a short gap
+};
+
+struct gesture_t {
+    action_t action;
+    uint8_t pad;  // the one touched first
+};
+
+/**
+ * @brief fed with every sample of the pads, each step is a handful of
+ * compares whatever the input, nothing waits in here
+ */
+class decoder_t {
+public:
+    /**
+     * @param touched bit n set while pad n is touched
+     * @param now_ms any clock in ms, it may wrap
+     */
+    gesture_t step(uint8_t touched, uint32_t now_ms) {
+        switch(m_state) {
+            case state_t::idle:
+                if(touched != 0) {
+                    m_pad   = touched & 1U ? 0 : 1;
+                    m_since = now_ms;
+                    m_state = state_t::pressed;
+                    return {press, m_pad};
+                }
+                return {none, m_pad};
+
+            case state_t::pressed:
+                if(touched & other_bit()) {
+                    if(now_ms - m_since <= slide_ms) {
+                        m_state = state_t::done;
+                        return {slide, m_pad};
+                    }
+                }
+                if(!(touched & pad_bit())) {
+                    m_released = now_ms;
+                    m_state    = state_t::released;
+                    return {none, m_pad};
+                }
+                if(now_ms - m_since >= long_press_ms) {
+                    m_since = now_ms;
+                    m_state = state_t::holding;
+                    return {hold_start, m_pad};
+                }
+                return {none, m_pad};
+
+            case state_t::released:
+                if(touched & other_bit()) {
+                    m_state = state_t::done;
+                    return {now_ms - m_since <= slide_ms ? slide : tap, m_pad};
+                }
+                if(touched & pad_bit()) {
+                    // back on the same pad within the gap, it bounced
+                    m_state = state_t::pressed;
+                    return {none, m_pad};
+                }
+                if(now_ms - m_released >= slide_gap_ms) {
+                    m_state = state_t::idle;
+                    return {tap, m_pad};
+                }
+                return {none, m_pad};
+
+            case state_t::holding:
+                if(!(touched & pad_bit())) {
+                    m_state = touched ? state_t::done : state_t::idle;
+                    return {none, m_pad};
+                }
+                if(now_ms - m_since >= hold_step_ms) {
+                    m_since = now_ms;
+                    return {hold_step, m_pad};
+                }
+                return {none, m_pad};
+
+            case state_t::done:
+                // nothing new starts before every pad is let go
+                if(touched == 0) {
+                    m_state = state_t::idle;
+                }
+                return {none, m_pad};
+        }
+        return {none, m_pad};
+    }
+
+    /**
+     * @brief nothing touched and nothing pending, no need to sample
+     */
+    bool idle() const {
+        return m_state == state_t::idle;
+    }
+
+private:
+    enum class state_t : uint8_t {
+        idle,
+        pressed,
+        released,  // let go, a slide may still reach the other pad
+        holding,
+        done,
+    };
+
+    uint8_t pad_bit() const {
+        return 1U << m_pad;
+    }
+
+    uint8_t other_bit() const {
+        return 1U << (m_pad ^ 1U);
+    }
+
+    state_t m_state     = state_t::idle;
+    uint8_t m_pad       = 0;
+    uint32_t m_since    = 0;  // first touch, or the last hold step
+    uint32_t m_released = 0;
+};
+
+}  // namespace touch
@@ -0,0 +1,41 @@
+/**
+ * @file touch.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the two touch pads on the frame, straight to the LEDs without the
+ * BLE host in the way
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace touch {
+
+/**
+ * @brief touching a pad toggles its channel right away, holding it on then
+ * dims up or down from there; a slide from pad A to B takes the toggle back
+ * and brightens both channels, B to A darkens them
+ */
+void init();
+
+// touch to light has to fit in a 60 Hz frame, from the interrupt of the
+// first touch to the LEDs
+constexpr uint32_t frame_us = 16000;
+
+struct stats_t {
+    uint32_t taps;
+    uint32_t holds;
+    uint32_t slides;
+    uint32_t count;  // latencies measured, one per touch
+    uint32_t max_us;
+    uint32_t total_us;
+    uint32_t over_frame;
+};
+
+stats_t get_stats();
+
+}  // namespace touch
@@ -0,0 +1,242 @@
+/**
+ * @file touch.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/touch_pad.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "touch.hpp"
+#include "gesture.hpp"
+#include "ambient.hpp"
+#include "board_configs.hpp"
+#include "effects.hpp"
+#include "event_loop.hpp"
+#include "leds.hpp"
+#include "scheduler.hpp"
+
+namespace touch {
+
+namespace {
+
+constexpr auto TAG = "TOUCH";
+
+constexpr touch_pad_t pads[num_pads] = {
+    board_configs::TOUCH_PAD_A,
+    board_configs::TOUCH_PAD_B,
+};
+constexpr uint32_t pad_mask = 1U << pads[0] | 1U << pads[1];
+
+// a finger pulls the count below this share of the untouched one
+constexpr uint32_t threshold_percent = 67;
+constexpr uint32_t filter_period_ms  = 10;
+// the hardware measures a pad every ~3 ms, the default sleeps ~27 ms between
+// measurements, so a read always finds a fresh one
+constexpr uint16_t sleep_cycles = 0x100;
+constexpr uint16_t meas_cycles  = 0x2000;
+// while touched the pads are read once a tick, 10 ms at the 100 Hz tick,
+// the finest the event loop deadlines go
+constexpr TickType_t poll_ticks = 1;
+
+constexpr uint8_t max_brightness = 100;
+constexpr int slide_step         = 25;
+constexpr int hold_step_size     = 2;
+
+uint16_t thresholds[num_pads] = {0};
+decoder_t decoder;
+
+// the interrupt of the touch, the hardware saw the finger then
+volatile int64_t isr_us = 0;
+
+uint8_t last_on[2] = {max_brightness, max_brightness};
+bool ramp_up[2]    = {false, false};
+// before the press toggled it, a slide takes the toggle back
+uint8_t before_press[2] = {0, 0};
+
+stats_t stats = {};
+
+leds::channel_t channel_of(uint8_t pad) {
+    return pad == 0 ? leds::channel0 : leds::channel1;
+}
+
+uint8_t stepped(uint8_t brightness, int delta) {
+    const int value = brightness + delta;
+    if(value < 0) {
+        return 0;
+    }
+    return value > max_brightness ? max_brightness : value;
+}
+
+void set(leds::channel_t channel, uint8_t brightness) {
+    effects::stop();
+    scheduler::cancel_ramp(channel);
+    leds::push_message({channel, brightness});
+}
+
+void ramp(leds::channel_t channel, int delta) {
+    set(channel, stepped(leds::get_brightness(channel), delta));
+}
+
+/**
+ * @return false if the gesture leaves the LEDs alone
+ */
+bool act(const gesture_t &gesture) {
+    const auto channel    = channel_of(gesture.pad);
+    const uint8_t current = leds::get_brightness(channel);
+    switch(gesture.action) {
+        case press:
+            // acted on at once, waiting to tell a tap from the rest would
+            // take the whole touch
+            before_press[channel] = current;
+            if(current > 0) {
+                last_on[channel] = current;
+                set(channel, 0);
+            }
+            else {
+                set(channel, last_on[channel]);
+            }
+            return true;
+
+        case tap:
+            // the press already toggled it
+            ++stats.taps;
+            return false;
+
+        case hold_start:
+            ++stats.holds;
+            // the other way from the last hold, unless there is no room
+            ramp_up[channel] = current == 0
+                               || (current < max_brightness
+                                   && !ramp_up[channel]);
+            ramp(channel, ramp_up[channel] ? hold_step_size : -hold_step_size);
+            return true;
+
+        case hold_step:
+            ramp(channel, ramp_up[channel] ? hold_step_size : -hold_step_size);
+            return true;
+
+        case slide: {
+            ++stats.slides;
+            const int delta  = gesture.pad == 0 ? slide_step : -slide_step;
+            const auto other = channel_of(gesture.pad ^ 1U);
+            set(channel, stepped(before_press[channel], delta));
+            ramp(other, delta);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void record_latency(uint32_t latency_us) {
+    ++stats.count;
+    stats.total_us += latency_us;
+    if(latency_us > stats.max_us) {
+        stats.max_us = latency_us;
+    }
+    if(latency_us > frame_us) {
+        ++stats.over_frame;
+        ESP_LOGW(TAG, "touch to light took %u us", latency_us);
+    }
+}
+
+uint8_t sample() {
+    uint8_t touched = 0;
+    for(uint8_t i = 0; i < num_pads; ++i) {
+        uint16_t value = 0;
+        touch_pad_read_raw_data(pads[i], &value);
+        if(value < thresholds[i]) {
+            touched |= 1U << i;
+        }
+    }
+    return touched;
+}
+
+void on_touch() {
+    const int64_t now_us = esp_timer_get_time();
+    const auto gesture   = decoder.step(sample(), now_us / 1000);
+    if(act(gesture)) {
+        leds::flush();
+        // the first light of a touch, the rest follows the finger on purpose
+        if(gesture.action == press) {
+            record_latency(esp_timer_get_time() - (isr_us ? isr_us : now_us));
+            isr_us = 0;
+        }
+        ambient::set_enabled(false);
+    }
+
+    // polled while touched, the interrupt only tells about a new touch
+    if(decoder.idle()) {
+        touch_pad_clear_status();
+        touch_pad_intr_enable();
+    }
+    else {
+        event_loop::post_after(event_loop::touch, poll_ticks);
+    }
+}
+
+void on_interrupt(void *ignore) {
+    const uint32_t status = touch_pad_get_status();
+    touch_pad_clear_status();
+    if((status & pad_mask) == 0) {
+        return;
+    }
+    touch_pad_intr_disable();
+    isr_us           = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    event_loop::post_from_isr(event_loop::touch, &woken);
+    if(woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+}  // namespace
+
+
+stats_t get_stats() {
+    return stats;
+}
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    ESP_ERROR_CHECK(touch_pad_init());
+    touch_pad_set_meas_time(sleep_cycles, meas_cycles);
+    touch_pad_set_voltage(TOUCH_HVOLT_2V7, TOUCH_LVOLT_0V5,
+                          TOUCH_HVOLT_ATTEN_1V);
+    for(auto pad : pads) {
+        touch_pad_config(pad, 0);
+    }
+    touch_pad_filter_start(filter_period_ms);
+    // lets the filter settle on the untouched counts
+    vTaskDelay(pdMS_TO_TICKS(filter_period_ms * 5));
+
+    for(uint8_t i = 0; i < num_pads; ++i) {
+        uint16_t untouched = 0;
+        touch_pad_read_filtered(pads[i], &untouched);
+        thresholds[i] = untouched * threshold_percent / 100;
+        touch_pad_set_thresh(pads[i], thresholds[i]);
+        ESP_LOGI(TAG, "pad %u: untouched %u, threshold %u", pads[i],
+                 untouched, thresholds[i]);
+    }
+
+    event_loop::set_handler(event_loop::touch, on_touch);
+    touch_pad_set_trigger_mode(TOUCH_TRIGGER_BELOW);
+    touch_pad_isr_register(on_interrupt, nullptr);
+    touch_pad_intr_enable();
+}
+
+}  // namespace touch
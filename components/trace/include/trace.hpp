@@ -0,0 +1,68 @@
+/**
+ * @file trace.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief always on ring of duty changes, downloaded over BLE and decoded by
+ * tools/trace_decode.py
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_timer.h"
+
+namespace trace {
+
+enum source_t : uint8_t {
+    ble_write  = 0,  // value is the brightness written [0-100]
+    leds_apply = 1,  // value is the duty on, on the leds::max_level scale
+    persist    = 2,  // value is the brightness saved [0-100]
+};
+
+struct __attribute__((packed)) event_t {
+    uint32_t timestamp_us;
+    source_t source;
+    uint8_t channel;
+    uint16_t value;
+};
+
+static_assert(sizeof(event_t) == 8, "event_t is part of the BLE protocol");
+
+// a power of two, 4 KiB of RAM
+constexpr uint32_t capacity = 512;
+
+extern event_t events[capacity];
+extern uint32_t head;
+
+/**
+ * @brief no lock, an atomic add, a timer read and four stores, safe from
+ * any task on either core
+ */
+inline void record(source_t source, uint8_t channel, uint16_t value) {
+    const uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    auto &event          = events[index & (capacity - 1)];
+    event.timestamp_us   = static_cast<uint32_t>(esp_timer_get_time());
+    event.source         = source;
+    event.channel        = channel;
+    event.value          = value;
+}
+
+/**
+ * @brief copy events from cursor on, cursor moves to the oldest event still
+ * in the ring if it fell behind, and past the last one copied
+ *
+ * @return how many events were copied
+ */
+size_t read(uint32_t &cursor, event_t *out, size_t max);
+
+/**
+ * @brief the cursor of the next event to be recorded
+ */
+uint32_t get_head();
+
+}  // namespace trace
@@ -0,0 +1,39 @@
+/**
+ * @file trace.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "trace.hpp"
+
+namespace trace {
+
+event_t events[capacity];
+uint32_t head = 0;
+
+size_t read(uint32_t &cursor, event_t *out, size_t max) {
+    const uint32_t end = get_head();
+    if(end - cursor > capacity) {
+        cursor = end - capacity;
+    }
+    size_t count = end - cursor;
+    if(count > max) {
+        count = max;
+    }
+    // an event being written right now may come out torn, fine for a trace
+    for(size_t i = 0; i < count; ++i) {
+        out[i] = events[(cursor + i) & (capacity - 1)];
+    }
+    cursor += count;
+    return count;
+}
+
+uint32_t get_head() {
+    return __atomic_load_n(&head, __ATOMIC_RELAXED);
+}
+
+}  // namespace trace
@@ -0,0 +1,49 @@
+/**
+ * @file watchdog.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief watches the brightness pipeline for a message waiting longer than
+ * a frame, the light would freeze without a word otherwise
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace watchdog {
+
+// a message has to be on the LEDs within a 60 Hz frame of being pushed
+constexpr uint32_t slo_us   = 16000;
+constexpr uint32_t check_us = 4000;
+
+constexpr uint8_t task_name_size = 16;
+
+/**
+ * @brief read over the diagnostics characteristic, keep the layout
+ */
+struct __attribute__((packed)) stats_t {
+    uint32_t violations;  // one per stall, however long it lasts
+    uint32_t queued_violations;
+    uint32_t applying_violations;
+    uint32_t boosts;      // times the event loop was raised over the SLO
+    uint32_t max_age_us;  // of a message still waiting, over all the stalls
+    uint8_t last_stage;   // leds::stage_t of the last violation
+    uint8_t last_event;   // event_loop::event_t running then
+    char last_task[task_name_size];  // running on the LEDs' core then
+    uint32_t stale;                  // leds::stats_t::stale
+    uint32_t coalesced;              // leds::stats_t::coalesced
+};
+
+/**
+ * @brief check the pipeline every check_us from the esp_timer task while a
+ * message waits, raise the event loop while it is late and put it back once
+ * it caught up; nothing runs while the pipeline is idle
+ */
+void init();
+
+stats_t get_stats();
+
+}  // namespace watchdog
@@ -0,0 +1,133 @@
+/**
+ * @file watchdog.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "watchdog.hpp"
+#include "event_loop.hpp"
+#include "leds.hpp"
+
+namespace watchdog {
+
+namespace {
+
+constexpr auto TAG = "WATCHDOG";
+
+esp_timer_handle_t timer = nullptr;
+
+// updated from the esp_timer task, read from the BLE host
+portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+stats_t stats     = {};
+
+// the stall already counted, by when its oldest message was pushed
+int64_t counted_since_us = 0;
+
+void record(const leds::pipeline_t &pipeline, uint32_t age_us) {
+    // the event loop runs on the APP CPU, whatever runs there holds it off
+    TaskHandle_t current = xTaskGetCurrentTaskHandleForCPU(APP_CPU_NUM);
+    const char *name     = current ? pcTaskGetTaskName(current) : "";
+    const auto event     = event_loop::get_running();
+
+    portENTER_CRITICAL(&lock);
+    ++stats.violations;
+    if(pipeline.stage == leds::stage_queued) {
+        ++stats.queued_violations;
+    }
+    else {
+        ++stats.applying_violations;
+    }
+    stats.last_stage = pipeline.stage;
+    stats.last_event = event;
+    strncpy(stats.last_task, name, task_name_size - 1);
+    stats.last_task[task_name_size - 1] = '\0';
+    portEXIT_CRITICAL(&lock);
+
+    ESP_LOGW(TAG, "stalled %u us in stage %u, event %u, task %s", age_us,
+             pipeline.stage, event, name);
+}
+
+/**
+ * @brief from the task pushing a message into the idle pipeline, the check
+ * that already runs is left alone
+ */
+void arm() {
+    esp_timer_start_once(timer, check_us);
+}
+
+void check(void *ignore) {
+    const auto pipeline = leds::get_pipeline();
+    if(pipeline.stage == leds::stage_idle) {
+        // caught up, nothing to hurry anymore and nothing to check until
+        // the next push arms it again
+        event_loop::boost(false);
+        return;
+    }
+    arm();
+
+    const auto age_us
+        = static_cast<uint32_t>(esp_timer_get_time() - pipeline.since_us);
+    portENTER_CRITICAL(&lock);
+    if(age_us > stats.max_age_us) {
+        stats.max_age_us = age_us;
+    }
+    portEXIT_CRITICAL(&lock);
+    if(age_us <= slo_us || pipeline.since_us == counted_since_us) {
+        return;
+    }
+    counted_since_us = pipeline.since_us;
+    record(pipeline, age_us);
+
+    if(event_loop::boost(true)) {
+        portENTER_CRITICAL(&lock);
+        ++stats.boosts;
+        portEXIT_CRITICAL(&lock);
+    }
+}
+
+}  // namespace
+
+
+void init() {
+    static bool initialized = false;
+    if(initialized) {
+        return;
+    }
+    initialized = true;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback        = check,
+        .arg             = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "watchdog",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    leds::set_queued_hook(arm);
+    // anything pushed before the hook was there
+    arm();
+    ESP_LOGI(TAG, "pipeline SLO %u us", slo_us);
+}
+
+stats_t get_stats() {
+    portENTER_CRITICAL(&lock);
+    stats_t current = stats;
+    portEXIT_CRITICAL(&lock);
+
+    const auto leds_stats = leds::get_stats();
+    current.stale         = leds_stats.stale;
+    current.coalesced     = leds_stats.coalesced;
+    return current;
+}
+
+}  // namespace watchdog
@@ -0,0 +1,73 @@
+/**
+ * @file check.hpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the few macros the host tests need, failures are counted and the
+ * test goes on
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+namespace check {
+
+inline int failures = 0;
+
+/**
+ * @return the exit code of the test, 0 if nothing failed
+ */
+inline int result() {
+    if(failures != 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("ok\n");
+    return 0;
+}
+
+/**
+ * @brief xorshift32, the same numbers on every run and every machine
+ */
+class xorshift_t {
+public:
+    explicit xorshift_t(uint32_t seed) : m_state(seed) {}
+
+    uint32_t operator()() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+private:
+    uint32_t m_state;
+};
+
+}  // namespace check
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if(!(cond)) {                                                     \
+            ++check::failures;                                            \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                        #cond);                                           \
+        }                                                                 \
+    } while(0)
+
+#define CHECK_EQ(a, b)                                                     \
+    do {                                                                   \
+        const auto check_a = (a);                                          \
+        const auto check_b = (b);                                          \
+        if(!(check_a == check_b)) {                                        \
+            ++check::failures;                                             \
+            std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                        __FILE__, __LINE__, #a, #b,                        \
+                        static_cast<long long>(check_a),                   \
+                        static_cast<long long>(check_b));                  \
+        }                                                                  \
+    } while(0)
@@ -0,0 +1,11 @@
+/**
+ * @file ledc.h
+ * @brief the LEDC types leds.hpp names, nothing behind them on the host
+ */
+#pragma once
+
+typedef enum {
+    LEDC_CHANNEL_0 = 0,
+    LEDC_CHANNEL_1,
+    LEDC_CHANNEL_MAX,
+} ledc_channel_t;
@@ -0,0 +1,202 @@
+/**
+ * @file test_ambient.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief replays the light sensor traces in data/ambient/ through the
+ * filter chain of the auto brightness
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The traces are made with tools/ambient_trace.py. Every trace in the
+ * directory, captured from a device or synthetic, goes through the checks
+ * of test_every_trace(); the synthetic ones also through their own.
+ */
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "filter.hpp"
+
+using namespace ambient;
+
+namespace {
+
+// the same as ambient.cpp
+constexpr range_t range   = {100, 2500, 5, 100};
+constexpr double frame_hz = 8000.0 / 1024;
+
+struct apply_t {
+    size_t frame;
+    uint8_t brightness;
+};
+
+constexpr auto *trace_dir = "data/ambient";
+
+std::vector<uint32_t> load_path(const std::string &path) {
+    std::ifstream file(path);
+    CHECK(file.good());
+    std::vector<uint32_t> trace;
+    for(std::string line; std::getline(file, line);) {
+        if(!line.empty() && line[0] != '#') {
+            trace.push_back(std::stoul(line));
+        }
+    }
+    return trace;
+}
+
+std::vector<uint32_t> load(const char *name) {
+    return load_path(std::string(trace_dir) + "/" + name + ".csv");
+}
+
+/**
+ * @brief the brightness applied on each frame it changed on
+ */
+std::vector<apply_t> replay(const std::vector<uint32_t> &trace) {
+    tracker_t tracker(range);
+    std::vector<apply_t> applied;
+    for(size_t frame = 0; frame < trace.size(); ++frame) {
+        if(tracker.update(trace[frame])) {
+            applied.push_back({frame, tracker.brightness()});
+        }
+    }
+    return applied;
+}
+
+uint8_t brightness_at(uint32_t mv) {
+    return to_brightness(mv, range.dark_mv, range.bright_mv, range.min_bri,
+                         range.max_bri);
+}
+
+void test_range_ends() {
+    CHECK_EQ(brightness_at(0), range.min_bri);
+    CHECK_EQ(brightness_at(range.dark_mv), range.min_bri);
+    CHECK_EQ(brightness_at(range.bright_mv), range.max_bri);
+    CHECK_EQ(brightness_at(5000), range.max_bri);
+    CHECK_EQ(brightness_at((range.dark_mv + range.bright_mv) / 2),
+             (range.min_bri + range.max_bri) / 2);
+}
+
+/**
+ * @brief whatever the light did: the brightness stays in the range, moves
+ * by no less than the hysteresis band and never turns back within a second
+ * of its last move, that would be chatter
+ */
+void test_every_trace() {
+    size_t traces = 0;
+    for(const auto &entry : std::filesystem::directory_iterator(trace_dir)) {
+        if(entry.path().extension() != ".csv") {
+            continue;
+        }
+        const auto trace   = load_path(entry.path().string());
+        const auto applied = replay(trace);
+        CHECK(!trace.empty());
+        CHECK(!applied.empty());
+        for(size_t i = 0; i < applied.size(); ++i) {
+            CHECK(applied[i].brightness >= range.min_bri);
+            CHECK(applied[i].brightness <= range.max_bri);
+            if(i == 0) {
+                continue;
+            }
+            const int step = applied[i].brightness - applied[i - 1].brightness;
+            CHECK(std::abs(step) >= 3);
+            if(i < 2) {
+                continue;
+            }
+            const int before = applied[i - 1].brightness
+                               - applied[i - 2].brightness;
+            if((step > 0) != (before > 0)) {
+                CHECK((applied[i].frame - applied[i - 1].frame) / frame_hz
+                      >= 1.0);
+            }
+        }
+        const double seconds = trace.size() / frame_hz;
+        std::printf("%s: %zu applies in %.0f s\n",
+                    entry.path().filename().c_str(), applied.size(), seconds);
+        ++traces;
+    }
+    CHECK(traces >= 3);
+}
+
+/**
+ * @brief a lamp turned on: one apply for the dark room, then a few on the
+ * way up that land close to the new level within seconds
+ */
+void test_step() {
+    const auto trace   = load("step");
+    const auto applied = replay(trace);
+    const size_t step  = static_cast<size_t>(10 * frame_hz);
+
+    CHECK(!applied.empty());
+    CHECK_EQ(applied.front().frame, 0U);
+    size_t before = 0;
+    for(const auto &apply : applied) {
+        before += apply.frame < step;
+    }
+    CHECK_EQ(before, 1U);
+
+    // settled once the applies stay within 5% of the target, the last one
+    // ends inside the hysteresis band
+    const uint8_t target = brightness_at(1800);
+    size_t settled       = 0;
+    for(size_t i = applied.size(); i-- > 0;) {
+        if(std::abs(applied[i].brightness - target) > 5) {
+            break;
+        }
+        settled = applied[i].frame;
+    }
+    CHECK(std::abs(applied.back().brightness - target) < 3);
+    CHECK(settled > step);
+    const double settle_s = (settled - step) / frame_hz;
+    CHECK(settle_s < 6.0);
+    // every apply on the way up takes the brightness further up
+    for(size_t i = 2; i < applied.size(); ++i) {
+        CHECK(applied[i].brightness > applied[i - 1].brightness);
+    }
+    std::printf("step: %zu applies, settled at %u (target %u) in %.1f s\n",
+                applied.size(), applied.back().brightness, target, settle_s);
+}
+
+/**
+ * @brief ten minutes of dusk only ever dims, in steps no smaller than the
+ * hysteresis band, and ends at the bottom of the range
+ */
+void test_dusk() {
+    const auto applied = replay(load("dusk"));
+    CHECK(!applied.empty());
+    for(size_t i = 1; i < applied.size(); ++i) {
+        CHECK(applied[i].brightness < applied[i - 1].brightness);
+        CHECK(applied[i - 1].brightness - applied[i].brightness >= 3);
+    }
+    CHECK(applied.back().brightness <= range.min_bri + 3);
+    CHECK(applied.size() <= (range.max_bri - range.min_bri) / 3 + 2U);
+    std::printf("dusk: %zu applies, %u to %u\n", applied.size(),
+                applied.front().brightness, applied.back().brightness);
+}
+
+/**
+ * @brief noise well over the hysteresis band before the filter does not
+ * make the LEDs chatter
+ */
+void test_flicker() {
+    const auto applied = replay(load("flicker"));
+    // the first frame, and at most one correction once the filter settles
+    CHECK(applied.size() <= 2U);
+    std::printf("flicker: %zu applies in %.0f s\n", applied.size(),
+                load("flicker").size() / frame_hz);
+}
+
+}  // namespace
+
+
+int main() {
+    test_range_ends();
+    test_every_trace();
+    test_step();
+    test_dusk();
+    test_flicker();
+    return check::result();
+}
@@ -0,0 +1,157 @@
+/**
+ * @file test_effects.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief renders the effects to duty timelines and compares them with the
+ * golden files in golden/
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * After a change to the renderer that is meant to change the output, look
+ * at the differences and write the new timelines with
+ *
+ *     UPDATE_GOLDEN=1 ./test_effects   (from host_test/)
+ */
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "check.hpp"
+#include "renderer.hpp"
+
+using namespace effects;
+
+namespace {
+
+template <size_t N>
+program_t compiled(const keyframe_t (&keyframes)[N], uint8_t flags) {
+    program_t program;
+    CHECK(compile({flags, N}, keyframes, program));
+    return program;
+}
+
+/**
+ * @brief one line per frame the levels changed on, or every sample_frames
+ * frames, as "time_ms level0 level1"
+ *
+ * @param late_frame a frame whose callback comes late, and by how much
+ */
+std::string timeline(const program_t &program, int64_t length_us,
+                     uint32_t sample_frames = 1, uint32_t late_frame = 0,
+                     int64_t late_us = 0) {
+    renderer_t renderer;
+    const uint16_t from[num_channels] = {0, 0};
+    renderer.start(program, from, 0);
+
+    std::ostringstream out;
+    int64_t shift_us = 0;
+    for(uint32_t frame = 1; frame * frame_period_us <= length_us; ++frame) {
+        if(frame == late_frame) {
+            shift_us = late_us;
+        }
+        const int64_t now_us = frame * frame_period_us + shift_us;
+        bool changed         = false;
+        renderer.render(now_us, [&](uint8_t, uint16_t) { changed = true; });
+        if((sample_frames == 1 && changed) || frame % sample_frames == 0
+           || !renderer.running()) {
+            out << now_us / 1000 << ' ' << renderer.level(0) << ' '
+                << renderer.level(1) << '\n';
+        }
+        if(!renderer.running()) {
+            break;
+        }
+    }
+    return out.str();
+}
+
+void golden(const char *name, const std::string &rendered) {
+    const std::string path = std::string("golden/effects_") + name + ".txt";
+    if(std::getenv("UPDATE_GOLDEN") != nullptr) {
+        std::ofstream(path) << rendered;
+        std::printf("wrote %s\n", path.c_str());
+        return;
+    }
+
+    std::ifstream file(path);
+    std::stringstream expected;
+    expected << file.rdbuf();
+    if(!file || expected.str() != rendered) {
+        ++check::failures;
+        // the first line that differs is enough to start looking
+        std::istringstream a(expected.str()), b(rendered);
+        std::string line_a, line_b;
+        for(int line = 1;; ++line) {
+            const bool more_a = static_cast<bool>(std::getline(a, line_a));
+            const bool more_b = static_cast<bool>(std::getline(b, line_b));
+            if(!more_a && !more_b) {
+                break;
+            }
+            if(line_a != line_b || more_a != more_b) {
+                std::printf("%s:%d: expected \"%s\", rendered \"%s\"\n",
+                            path.c_str(), line, more_a ? line_a.c_str() : "",
+                            more_b ? line_b.c_str() : "");
+                break;
+            }
+        }
+    }
+}
+
+void test_compile() {
+    program_t program;
+    const keyframe_t frames[] = {{0, {10, 10}, linear, 0}};
+    CHECK(!compile({0, 0}, frames, program));
+    CHECK(!compile({0, max_keyframes + 1}, frames, program));
+    // a loop that takes no time would never leave the frame callback
+    CHECK(!compile({loop, 1}, frames, program));
+    CHECK(compile({0, 1}, frames, program));
+}
+
+void test_sunrise_ends_on() {
+    renderer_t renderer;
+    const uint16_t from[num_channels] = {0, 0};
+    renderer.start(compiled(sunrise_frames, 0), from, 0);
+    // the whole sunrise is 10 minutes, one call past it lands on the end
+    renderer.render(11 * 60 * 1000 * 1000LL, [](uint8_t, uint16_t) {});
+    CHECK(!renderer.running());
+    CHECK_EQ(renderer.level(0), leds::max_level);
+    CHECK_EQ(renderer.level(1), leds::max_level);
+}
+
+void test_breathing_range() {
+    renderer_t renderer;
+    const uint16_t from[num_channels] = {to_level(10), to_level(10)};
+    renderer.start(compiled(breathing_frames, loop), from, 0);
+    uint16_t low = leds::max_level, high = 0;
+    for(int64_t t = 0; t < 20 * 1000 * 1000; t += frame_period_us) {
+        renderer.render(t, [&](uint8_t, uint16_t level) {
+            low  = level < low ? level : low;
+            high = level > high ? level : high;
+        });
+    }
+    CHECK(renderer.running());
+    CHECK(low >= to_level(10));
+    CHECK(high <= to_level(80));
+    CHECK(high >= to_level(79));
+}
+
+}  // namespace
+
+
+int main() {
+    test_compile();
+    test_sunrise_ends_on();
+    test_breathing_range();
+
+    // two laps, every frame
+    golden("breathing", timeline(compiled(breathing_frames, loop), 8000000));
+    // the 10 minutes of it, once a second
+    golden("sunrise", timeline(compiled(sunrise_frames, 0), 610000000, 50));
+    // the jitter comes from the renderer's own generator, it repeats
+    golden("candle", timeline(compiled(candle_frames, loop), 4000000));
+    // a 3 s stall half way through the first breath catches up a lap
+    golden("breathing_late", timeline(compiled(breathing_frames, loop),
+                                      8000000, 1, 100, 3000000));
+    return check::result();
+}
@@ -0,0 +1,166 @@
+/**
+ * @file test_gesture.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the pad samples of taps, holds and slides through the decoder,
+ * read every 10 ms as touch.cpp does; every touch is pressed on its first
+ * sample
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstdint>
+#include <vector>
+
+#include "check.hpp"
+#include "gesture.hpp"
+
+using namespace touch;
+
+namespace {
+
+constexpr uint32_t poll_ms = 10;
+
+/**
+ * @brief a span of time with the same pads touched
+ */
+struct span_t {
+    uint8_t touched;
+    uint32_t ms;
+};
+
+/**
+ * @brief every gesture told, polled until the decoder is idle again
+ */
+struct told_t {
+    std::vector<gesture_t> gestures;
+    std::vector<uint32_t> at_ms;  // since the first sample
+};
+
+told_t run(const std::vector<span_t> &spans) {
+    decoder_t decoder;
+    told_t told;
+    const uint32_t start = 0x7ffffff0;  // wraps on the way
+    uint32_t now         = start;
+    const auto step      = [&](uint8_t touched) {
+        const auto gesture = decoder.step(touched, now);
+        if(gesture.action != none) {
+            told.gestures.push_back(gesture);
+            told.at_ms.push_back(now - start);
+        }
+        now += poll_ms;
+    };
+    for(const auto &span : spans) {
+        for(uint32_t t = 0; t < span.ms; t += poll_ms) {
+            step(span.touched);
+        }
+    }
+    for(int i = 0; i < 100 && !decoder.idle(); ++i) {
+        step(0);
+    }
+    CHECK(decoder.idle());
+    return told;
+}
+
+/**
+ * @brief the actions told, the press that starts it all checked on the way:
+ * on the very first sample, for the pad touched first
+ */
+std::vector<action_t> actions(const told_t &told, uint8_t pad) {
+    CHECK(!told.gestures.empty());
+    CHECK_EQ(told.gestures[0].action, press);
+    CHECK_EQ(told.gestures[0].pad, pad);
+    CHECK_EQ(told.at_ms[0], 0U);
+    std::vector<action_t> rest;
+    for(size_t i = 1; i < told.gestures.size(); ++i) {
+        rest.push_back(told.gestures[i].action);
+        if(told.gestures[i].action != press) {
+            CHECK_EQ(told.gestures[i].pad, told.gestures[i - 1].pad);
+        }
+    }
+    return rest;
+}
+
+void test_tap() {
+    const auto rest = actions(run({{0b01, 100}}), 0);
+    CHECK_EQ(rest.size(), 1U);
+    CHECK_EQ(rest[0], tap);
+}
+
+void test_hold() {
+    const auto rest = actions(run({{0b10, 600}}), 1);
+    CHECK(rest.size() > 1);
+    CHECK_EQ(rest[0], hold_start);
+    for(size_t i = 1; i < rest.size(); ++i) {
+        CHECK_EQ(rest[i], hold_step);
+    }
+}
+
+void test_slide_touching() {
+    const auto rest = actions(run({{0b01, 80}, {0b11, 30}, {0b10, 50}}), 0);
+    CHECK_EQ(rest.size(), 1U);
+    CHECK_EQ(rest[0], slide);
+}
+
+/**
+ * @brief the finger leaves the first pad before it reaches the second
+ */
+void test_slide_with_gap() {
+    for(uint32_t gap = poll_ms; gap < slide_gap_ms; gap += poll_ms) {
+        const auto rest = actions(run({{0b10, 80}, {0, gap}, {0b01, 50}}), 1);
+        CHECK_EQ(rest.size(), 1U);
+        CHECK_EQ(rest[0], slide);
+    }
+}
+
+/**
+ * @brief past the gap the first pad was a tap, the second one starts
+ * something new with a press of its own
+ */
+void test_gap_too_long() {
+    const auto told = run({{0b01, 80}, {0, slide_gap_ms + 20}, {0b10, 50}});
+    const auto rest = actions(told, 0);
+    CHECK_EQ(rest.size(), 3U);
+    CHECK_EQ(rest[0], tap);
+    CHECK_EQ(rest[1], press);
+    CHECK_EQ(told.gestures[2].pad, 1);
+    CHECK_EQ(rest[2], tap);
+}
+
+/**
+ * @brief too slow to be a slide even with the pads touching
+ */
+void test_slide_too_slow() {
+    const auto rest = actions(run({{0b01, 280}, {0, 40}, {0b10, 50}}), 0);
+    CHECK_EQ(rest.size(), 1U);
+    CHECK_EQ(rest[0], tap);
+}
+
+/**
+ * @brief a finger that bounces off the pad for a sample is still the same
+ * touch, pressed once
+ */
+void test_bounce() {
+    const auto tapped = actions(run({{0b01, 50}, {0, 10}, {0b01, 50}}), 0);
+    CHECK_EQ(tapped.size(), 1U);
+    CHECK_EQ(tapped[0], tap);
+
+    const auto held = actions(run({{0b01, 200}, {0, 20}, {0b01, 300}}), 0);
+    CHECK(!held.empty());
+    CHECK_EQ(held[0], hold_start);
+}
+
+}  // namespace
+
+
+int main() {
+    test_tap();
+    test_hold();
+    test_slide_touching();
+    test_slide_with_gap();
+    test_gap_too_long();
+    test_slide_too_slow();
+    test_bounce();
+    return check::result();
+}
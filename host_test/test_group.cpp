@@ -0,0 +1,340 @@
+/**
+ * @file test_group.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief the group packet, its MAC and the replay check, then bursts of it
+ * through a lossy radio to several mirrors for the skew of the apply times
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The radio timings are the ones of ble_server.cpp, change them here along
+ * with the firmware:
+ *
+ *     test_group [nodes] [trials] [pdu loss %]
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "check.hpp"
+#include "packet.hpp"
+
+using namespace group;
+
+namespace {
+
+check::xorshift_t xorshift(0x1b873593);
+
+/**
+ * @brief stands in for HMAC-SHA256, keyed and spread over every byte of the
+ * digest; what is under test is which bytes go in and how the MAC is
+ * compared
+ */
+struct fake_hmac_t {
+    uint32_t key;
+
+    void operator()(const uint8_t *data, size_t len, uint8_t *digest) const {
+        uint32_t hash = 2166136261U ^ key;
+        for(size_t i = 0; i < len; ++i) {
+            hash = (hash ^ data[i]) * 16777619U;
+        }
+        check::xorshift_t spread(hash | 1);
+        for(size_t i = 0; i < 32; ++i) {
+            digest[i] = spread();
+        }
+    }
+};
+
+constexpr uint8_t group_id  = 7;
+constexpr fake_hmac_t hmac  = {0xc0ffee};
+constexpr uint32_t sender_a = 0x11223344;
+constexpr uint32_t sender_b = 0x55667788;
+
+packet_t make(uint32_t sender, uint32_t seq, uint16_t countdown_ms = 150) {
+    packet_t packet     = {};
+    packet.company      = company_id;
+    packet.version      = version;
+    packet.group_id     = group_id;
+    packet.sender       = sender;
+    packet.seq          = seq;
+    packet.channel      = 1;
+    packet.brightness   = 42;
+    packet.countdown_ms = countdown_ms;
+    sign(packet, hmac);
+    return packet;
+}
+
+/**
+ * @brief any bit flipped under the MAC, or in it, and the packet is refused
+ */
+void test_mac() {
+    const packet_t packet = make(sender_a, 1);
+    CHECK(verify(packet, hmac));
+    CHECK(!verify(packet, fake_hmac_t{hmac.key + 1}));
+    size_t refused = 0;
+    for(size_t byte = 0; byte < sizeof packet; ++byte) {
+        for(int bit = 0; bit < 8; ++bit) {
+            packet_t tampered = packet;
+            reinterpret_cast<uint8_t *>(&tampered)[byte] ^= 1U << bit;
+            refused += !verify(tampered, hmac);
+        }
+    }
+    CHECK_EQ(refused, sizeof packet * 8);
+    // the sender is under the MAC, the replay check trusts it
+    CHECK(offsetof(packet_t, sender) + sizeof packet.sender <= signed_size);
+}
+
+void test_addressing() {
+    packet_t packet = make(sender_a, 1);
+    CHECK(addressed_to(packet, group_id, sender_b));
+    // our own burst, heard back
+    CHECK(!addressed_to(packet, group_id, sender_a));
+    CHECK(!addressed_to(packet, group_id + 1, sender_b));
+    packet.version = version - 1;
+    CHECK(!addressed_to(packet, group_id, sender_b));
+
+    packet = make(sender_a, 1);
+    CHECK(applicable(packet));
+    packet.channel = 2;
+    CHECK(!applicable(packet));
+    packet.channel    = 0;
+    packet.brightness = 101;
+    CHECK(!applicable(packet));
+}
+
+void test_countdown() {
+    CHECK_EQ(countdown_of(-5), 0);
+    CHECK_EQ(countdown_of(999), 0);
+    CHECK_EQ(countdown_of(150999), 150);
+    CHECK_EQ(countdown_of(int64_t{1} << 40), 0xffff);
+}
+
+/**
+ * @brief repeats of a burst are dropped quietly, older sequences are
+ * replays, gaps are misses unless the sender rebooted into a new block
+ */
+void test_sequence() {
+    senders_t senders;
+    stats_t stats = {};
+    CHECK(senders.take(sender_a, 10, stats));
+    CHECK(!senders.take(sender_a, 10, stats));
+    CHECK(!senders.take(sender_a, 9, stats));
+    CHECK_EQ(stats.replayed, 1U);
+    CHECK(senders.take(sender_a, 13, stats));
+    CHECK_EQ(stats.missed, 2U);
+    CHECK(senders.take(sender_a, 13 + seq_block + 5, stats));
+    CHECK_EQ(stats.missed, 2U);
+    // each sender has its own sequence
+    CHECK(senders.take(sender_b, 1, stats));
+    CHECK_EQ(stats.received, 4U);
+    CHECK_EQ(stats.replayed, 1U);
+}
+
+/**
+ * @brief the table saved as it is comes back after a reboot with what was
+ * seen, a capture of an old burst is still a replay
+ */
+void test_reboot() {
+    senders_t senders;
+    stats_t stats = {};
+    for(uint32_t seq = 1; seq <= 20; ++seq) {
+        senders.take(sender_a, seq, stats);
+    }
+    uint8_t blob[sizeof senders];
+    memcpy(blob, &senders, sizeof blob);
+
+    senders_t restored;
+    memcpy(&restored, blob, sizeof restored);
+    stats = {};
+    for(uint32_t seq = 1; seq <= 20; ++seq) {
+        CHECK(!restored.take(sender_a, seq, stats));
+    }
+    CHECK_EQ(stats.replayed, 19U);
+    CHECK(restored.take(sender_a, 21, stats));
+
+    restored.clear();
+    CHECK(restored.take(sender_a, 1, stats));
+}
+
+/**
+ * @brief more senders than the table holds, the oldest one is forgotten
+ */
+void test_eviction() {
+    senders_t senders;
+    stats_t stats = {};
+    for(uint32_t id = 1; id <= max_senders; ++id) {
+        CHECK(senders.take(id, 100, stats));
+    }
+    for(uint32_t id = 1; id <= max_senders; ++id) {
+        CHECK(!senders.take(id, 100, stats));
+    }
+    CHECK(senders.take(max_senders + 1, 100, stats));
+    // forgotten, taken again as new
+    CHECK(senders.take(1, 100, stats));
+}
+
+// the same as ble_server.cpp, in us
+constexpr int64_t adv_itvl_us    = 20000;  // group_adv_itvl
+constexpr int64_t adv_delay_us   = 10000;  // advDelay of the controller
+constexpr int64_t channel_gap_us = 400;    // a PDU on 37, 38 then 39
+constexpr int64_t refresh_us     = 10000;  // group_refresh_us
+constexpr int64_t scan_itvl_us   = 40000;  // group_scan_itvl
+constexpr int64_t scan_window_us = 30000;  // group_scan_window
+constexpr int64_t host_min_us    = 200;    // controller to receive()
+constexpr int64_t host_max_us    = 2000;
+constexpr int64_t delay_us       = delay_ms * 1000;
+
+int64_t uniform(int64_t lo, int64_t hi) {
+    return lo + static_cast<int64_t>(xorshift() % (hi - lo + 1));
+}
+
+struct pdu_t {
+    int64_t at_us;
+    uint8_t channel;
+    uint8_t data[sizeof(packet_t)];
+};
+
+/**
+ * @brief every PDU of a burst, with the data payload() had set by then
+ */
+std::vector<pdu_t> burst(uint32_t seq) {
+    std::vector<pdu_t> pdus;
+    const int64_t refresh_phase = uniform(0, refresh_us - 1);
+    for(int64_t t = uniform(0, adv_itvl_us); t < delay_us;
+        t += adv_itvl_us + uniform(0, adv_delay_us)) {
+        // the data of the last refresh, the first one is set with the burst
+        const int64_t refreshed =
+            t < refresh_phase ? 0 : t - (t - refresh_phase) % refresh_us;
+        packet_t packet     = make(sender_a, seq);
+        packet.countdown_ms = countdown_of(delay_us - refreshed);
+        sign(packet, hmac);
+        for(uint8_t channel = 0; channel < 3; ++channel) {
+            pdu_t pdu = {t + channel * channel_gap_us, channel, {0}};
+            memcpy(pdu.data, &packet, sizeof packet);
+            pdus.push_back(pdu);
+        }
+    }
+    return pdus;
+}
+
+/**
+ * @brief a mirror of the group scanning, what receive() does with each
+ * packet heard
+ */
+struct node_t {
+    uint32_t id;
+    int64_t scan_phase_us;
+    senders_t senders;
+    stats_t stats;
+    int64_t apply_us;  // -1 while nothing is scheduled
+
+    int scanning(int64_t t) const {
+        const int64_t since = t + scan_phase_us;
+        if(since % scan_itvl_us >= scan_window_us) {
+            return -1;
+        }
+        return static_cast<int>((since / scan_itvl_us) % 3);
+    }
+
+    void receive(const uint8_t *data, int64_t now_us) {
+        packet_t packet;
+        memcpy(&packet, data, sizeof packet);
+        if(!addressed_to(packet, group_id, id)) {
+            return;
+        }
+        if(!verify(packet, hmac)) {
+            ++stats.bad_mac;
+            return;
+        }
+        if(!senders.take(packet.sender, packet.seq, stats)) {
+            return;
+        }
+        if(applicable(packet)) {
+            apply_us = now_us + packet.countdown_ms * 1000;
+        }
+    }
+};
+
+int64_t percentile(std::vector<int64_t> values, unsigned percent) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1,
+                           values.size() * percent / 100)];
+}
+
+/**
+ * @brief one mirror takes a write and bursts it, the others apply it when
+ * the countdown they heard runs out: every one gets it and they light
+ * within a frame of each other
+ */
+void test_sync(size_t nodes, size_t trials, unsigned loss_percent) {
+    std::vector<node_t> receivers(nodes - 1);
+    for(size_t i = 0; i < receivers.size(); ++i) {
+        receivers[i].id = 0x1000 + i;
+    }
+    std::vector<int64_t> skews;
+    size_t missed = 0;
+    for(uint32_t seq = 1; seq <= trials; ++seq) {
+        const auto pdus = burst(seq);
+        std::vector<int64_t> applied = {delay_us};  // the sender's own timer
+        for(auto &node : receivers) {
+            node.scan_phase_us = uniform(0, 3 * scan_itvl_us - 1);
+            node.apply_us      = -1;
+            for(const auto &pdu : pdus) {
+                if(node.scanning(pdu.at_us) != pdu.channel
+                   || xorshift() % 100 < loss_percent) {
+                    continue;
+                }
+                node.receive(pdu.data,
+                             pdu.at_us + uniform(host_min_us, host_max_us));
+            }
+            if(node.apply_us < 0) {
+                ++missed;
+                continue;
+            }
+            applied.push_back(node.apply_us);
+        }
+        const auto [lo, hi] = std::minmax_element(applied.begin(),
+                                                  applied.end());
+        skews.push_back(*hi - *lo);
+    }
+
+    const size_t heard = trials * receivers.size();
+    std::printf("%zu commands, %zu nodes, pdu loss %u%%\n", trials, nodes,
+                loss_percent);
+    std::printf("missed %zu of %zu\n", missed, heard);
+    std::printf("skew ms: p50 %.1f, p90 %.1f, p99 %.1f, p100 %.1f\n",
+                percentile(skews, 50) / 1000.0,
+                percentile(skews, 90) / 1000.0,
+                percentile(skews, 99) / 1000.0,
+                percentile(skews, 100) / 1000.0);
+    // each command taken once, the repeats of its burst dropped quietly
+    size_t received = 0;
+    for(const auto &node : receivers) {
+        received += node.stats.received;
+        CHECK_EQ(node.stats.replayed, 0U);
+        CHECK_EQ(node.stats.bad_mac, 0U);
+    }
+    CHECK_EQ(received, heard - missed);
+    CHECK(missed * 1000 <= heard);
+    CHECK(percentile(skews, 99) < 16000);
+}
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    test_mac();
+    test_addressing();
+    test_countdown();
+    test_sequence();
+    test_reboot();
+    test_eviction();
+    const size_t nodes  = argc > 1 ? std::atoi(argv[1]) : 3;
+    const size_t trials = argc > 2 ? std::atoi(argv[2]) : 10000;
+    const unsigned loss = argc > 3 ? std::atoi(argv[3]) : 10;
+    if(nodes >= 2 && trials >= 1) {
+        test_sync(nodes, trials, loss);
+    }
+    return check::result();
+}
@@ -0,0 +1,318 @@
+/**
+ * @file test_ota.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief images streamed through the credit, the double buffer and the
+ * writer onto a fake flash, with the failures the device can meet
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "check.hpp"
+#include "stream.hpp"
+
+using namespace ota;
+
+namespace {
+
+constexpr size_t sector_size = 4096;
+constexpr size_t write_len   = 244;  // a 247 byte MTU less the ATT header
+
+/**
+ * @brief a partition of erased sectors that refuses writes out of order or
+ * over bytes already written, and can fail on purpose
+ */
+class fake_flash_t {
+public:
+    static constexpr int ok           = 0;
+    static constexpr int invalid_size = 1;
+    static constexpr int invalid_crc  = 2;
+    static constexpr int fail         = 3;
+
+    explicit fake_flash_t(size_t capacity) : memory(capacity, 0xff) {}
+
+    int begin(uint32_t size) {
+        if(open) {
+            return fail;
+        }
+        if(size > memory.size()) {
+            return invalid_size;
+        }
+        std::fill(memory.begin(), memory.end(), 0xff);
+        open   = true;
+        offset = 0;
+        writes = 0;
+        return ok;
+    }
+
+    int write(const uint8_t *data, size_t len) {
+        if(!open || offset + len > memory.size() || offset + len > fail_at) {
+            return fail;
+        }
+        for(size_t i = 0; i < len; ++i) {
+            CHECK_EQ(memory[offset + i], 0xff);
+        }
+        // the writer hands out whole buffers, each lands on its own sector
+        CHECK_EQ(offset % sector_size, 0U);
+        memcpy(&memory[offset], data, len);
+        offset += len;
+        ++writes;
+        return ok;
+    }
+
+    int end() {
+        if(!open) {
+            return fail;
+        }
+        open = false;
+        return ok;
+    }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t len) {
+        crc = ~crc;
+        for(size_t i = 0; i < len; ++i) {
+            crc ^= data[i];
+            for(int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+            }
+        }
+        return ~crc;
+    }
+
+    std::vector<uint8_t> memory;
+    bool open      = false;
+    size_t offset  = 0;
+    size_t writes  = 0;
+    size_t fail_at = SIZE_MAX;
+};
+
+check::xorshift_t xorshift(0x2545f491);
+
+std::vector<uint8_t> random_image(size_t size) {
+    std::vector<uint8_t> image(size);
+    for(auto &byte : image) {
+        byte = xorshift();
+    }
+    return image;
+}
+
+/**
+ * @brief what ota.cpp does, with the writer task run in between the client
+ * writes at random instead of on its own core
+ *
+ * Every chunk keeps a copy of what it held when submitted, a buffer filled
+ * again before the writer took it shows up as a difference.
+ */
+struct session_t {
+    struct chunk_t {
+        uint8_t buffer;
+        std::vector<uint8_t> data;
+    };
+
+    explicit session_t(size_t capacity = 64 * 1024) : flash(capacity) {}
+
+    int begin(uint32_t size, uint32_t crc32) {
+        chunker.reset();
+        credits.reset();
+        queue.clear();
+        status = writer.begin(size, crc32);
+        if(status == fake_flash_t::ok) {
+            credits.grant(num_buffers * chunk_size);
+        }
+        return status;
+    }
+
+    /**
+     * @return false if the client went past its credit
+     */
+    bool send(const uint8_t *data, size_t len) {
+        if(!credits.spend(len)) {
+            writer.abort();
+            return false;
+        }
+        chunker.push(data, len, [&](uint8_t buffer, size_t len) {
+            submit(buffer, len);
+        });
+        return true;
+    }
+
+    /**
+     * @brief the writer task takes up to count chunks off the queue
+     */
+    void drain(size_t count = SIZE_MAX) {
+        for(; count > 0 && !queue.empty(); --count) {
+            const chunk_t chunk = queue.front();
+            queue.pop_front();
+            const uint8_t *data = chunker.buffer(chunk.buffer);
+            CHECK(memcmp(data, chunk.data.data(), chunk.data.size()) == 0);
+            if(!writer.writing()) {
+                continue;
+            }
+            const int ret = writer.write(data, chunk.data.size());
+            if(ret != fake_flash_t::ok) {
+                status = ret;
+                continue;
+            }
+            credits.grant(chunk.data.size());
+        }
+    }
+
+    int end() {
+        chunker.flush([&](uint8_t buffer, size_t len) { submit(buffer, len); });
+        drain();
+        if(!writer.writing()) {
+            return status;
+        }
+        return writer.end();
+    }
+
+    /**
+     * @brief the client sends the image as fast as its credit lets it
+     *
+     * @return the number of times it had to wait for credit
+     */
+    size_t stream(const std::vector<uint8_t> &image) {
+        size_t waits = 0;
+        for(size_t sent = 0; sent < image.size();) {
+            const size_t len = std::min({write_len, image.size() - sent,
+                                         static_cast<size_t>(credits.left())});
+            if(len == 0) {
+                ++waits;
+                drain(1);
+                if(!writer.writing()) {
+                    break;
+                }
+                continue;
+            }
+            CHECK(send(&image[sent], len));
+            sent += len;
+            if(xorshift() % 8 == 0) {
+                drain(1);
+            }
+        }
+        return waits;
+    }
+
+    void submit(uint8_t buffer, size_t len) {
+        const uint8_t *data = chunker.buffer(buffer);
+        queue.push_back({buffer, std::vector<uint8_t>(data, data + len)});
+    }
+
+    fake_flash_t flash;
+    writer_t<fake_flash_t> writer{flash};
+    credits_t credits;
+    chunker_t chunker;
+    std::deque<chunk_t> queue;
+    int status = fake_flash_t::ok;
+};
+
+uint32_t crc_of(const std::vector<uint8_t> &image) {
+    return fake_flash_t::crc32(0, image.data(), image.size());
+}
+
+void test_crc32() {
+    // the check value of CRC-32 (zlib)
+    const char digits[] = "123456789";
+    CHECK_EQ(fake_flash_t::crc32(
+                 0, reinterpret_cast<const uint8_t *>(digits), 9),
+             0xcbf43926U);
+}
+
+void test_round_trip() {
+    // not a whole number of sectors, the tail goes out at end
+    const auto image = random_image(50 * 1000 + 17);
+    session_t session;
+    CHECK_EQ(session.begin(image.size(), crc_of(image)), fake_flash_t::ok);
+    const size_t waits = session.stream(image);
+    CHECK_EQ(session.end(), fake_flash_t::ok);
+
+    CHECK(!session.flash.open);
+    CHECK(std::equal(image.begin(), image.end(), session.flash.memory.begin()));
+    CHECK_EQ(session.flash.writes,
+             (image.size() + chunk_size - 1) / chunk_size);
+    CHECK_EQ(session.writer.written(), image.size());
+    // everything sent was written, and granted back
+    CHECK_EQ(session.credits.left(), num_buffers * chunk_size);
+    std::printf("%zu bytes in %zu writes, the client waited %zu times\n",
+                image.size(), session.flash.writes, waits);
+}
+
+void test_crc_mismatch() {
+    const auto image = random_image(10000);
+    session_t session;
+    session.begin(image.size(), crc_of(image) ^ 1);
+    session.stream(image);
+    CHECK_EQ(session.end(), fake_flash_t::invalid_crc);
+    CHECK(!session.flash.open);
+
+    // the flash was released, the right image goes through after
+    CHECK_EQ(session.begin(image.size(), crc_of(image)), fake_flash_t::ok);
+    session.stream(image);
+    CHECK_EQ(session.end(), fake_flash_t::ok);
+}
+
+void test_size_mismatch() {
+    const auto image = random_image(10000);
+
+    session_t shorter;
+    shorter.begin(image.size() + 1, crc_of(image));
+    shorter.stream(image);
+    CHECK_EQ(shorter.end(), fake_flash_t::invalid_size);
+    CHECK(!shorter.flash.open);
+
+    // a longer image stops at the chunk that goes past its size
+    session_t longer;
+    longer.begin(image.size() - chunk_size, crc_of(image));
+    longer.stream(image);
+    CHECK_EQ(longer.end(), fake_flash_t::invalid_size);
+    CHECK(!longer.flash.open);
+    CHECK(longer.writer.written() <= image.size() - chunk_size);
+
+    session_t too_big(8 * 1024);
+    CHECK_EQ(too_big.begin(image.size(), crc_of(image)),
+             fake_flash_t::invalid_size);
+    CHECK(!too_big.writer.writing());
+}
+
+void test_flash_failure() {
+    const auto image = random_image(40000);
+    session_t session;
+    session.flash.fail_at = 3 * chunk_size + 100;
+    session.begin(image.size(), crc_of(image));
+    session.stream(image);
+    CHECK_EQ(session.end(), fake_flash_t::fail);
+    CHECK(!session.flash.open);
+    CHECK_EQ(session.writer.written(), 3 * chunk_size);
+
+    // nothing is written after the failure
+    CHECK_EQ(session.flash.writes, 3U);
+}
+
+void test_credit_overrun() {
+    const auto image = random_image(3 * chunk_size);
+    session_t session;
+    session.begin(image.size(), crc_of(image));
+    // both buffers, and not a byte more, before the writer takes any
+    CHECK(session.send(image.data(), num_buffers * chunk_size));
+    CHECK(!session.send(image.data(), 1));
+    CHECK(!session.writer.writing());
+    CHECK(!session.flash.open);
+}
+
+}  // namespace
+
+
+int main() {
+    test_crc32();
+    test_round_trip();
+    test_crc_mismatch();
+    test_size_mismatch();
+    test_flash_failure();
+    test_credit_overrun();
+    return check::result();
+}
@@ -0,0 +1,122 @@
+/**
+ * @file test_phase.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief random duty sets through stagger(), the peak current against the
+ * one of every pulse starting at 0
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstdint>
+
+#include "check.hpp"
+#include "phase.hpp"
+
+using namespace leds;
+
+namespace {
+
+constexpr size_t max_channels = 4;
+
+check::xorshift_t xorshift(0x6d2b79f5);
+
+struct duties_t {
+    size_t count;
+    uint32_t period;
+    uint32_t pulse[max_channels];
+    uint32_t current[max_channels];
+};
+
+duties_t random_duties(size_t count) {
+    duties_t duties = {count, 64 + xorshift() % 2048, {0}, {0}};
+    for(size_t i = 0; i < count; ++i) {
+        // the ends of the range come up often enough to be covered
+        const uint32_t pick = xorshift() % 8;
+        duties.pulse[i]     = pick == 0   ? 0
+                              : pick == 1 ? duties.period
+                                          : xorshift() % (duties.period + 1);
+        duties.current[i] = 1 + xorshift() % 1000;
+    }
+    return duties;
+}
+
+uint32_t peak(const duties_t &duties, const uint32_t *hpoint) {
+    interval_t on[max_channels];
+    for(size_t i = 0; i < duties.count; ++i) {
+        on[i] = {hpoint[i], duties.pulse[i]};
+    }
+    return peak_current(on, duties.current, duties.count, duties.period);
+}
+
+/**
+ * @brief counts of the period with both channels on, walked one by one
+ */
+uint32_t overlap(const duties_t &duties, const uint32_t *hpoint) {
+    const interval_t a = {hpoint[0], duties.pulse[0]};
+    const interval_t b = {hpoint[1], duties.pulse[1]};
+    uint32_t both      = 0;
+    for(uint32_t t = 0; t < duties.period; ++t) {
+        both += contains(a, t, duties.period) && contains(b, t, duties.period);
+    }
+    return both;
+}
+
+/**
+ * @brief staggered, the peak is never above the one of the pulses all
+ * starting together and no pulse runs past the end of the period
+ */
+void test_never_worse() {
+    size_t lower = 0;
+    for(int run = 0; run < 20000; ++run) {
+        const auto duties = random_duties(2 + xorshift() % (max_channels - 1));
+        uint32_t hpoint[max_channels];
+        stagger(duties.pulse, hpoint, duties.count, duties.period);
+        const uint32_t together[max_channels] = {0};
+
+        uint32_t sum = 0, highest = 0;
+        for(size_t i = 0; i < duties.count; ++i) {
+            CHECK(hpoint[i] < duties.period);
+            CHECK(hpoint[i] + duties.pulse[i] <= duties.period);
+            sum += duties.pulse[i];
+            if(duties.pulse[i] > 0 && duties.current[i] > highest) {
+                highest = duties.current[i];
+            }
+        }
+
+        const uint32_t staggered = peak(duties, hpoint);
+        CHECK(staggered <= peak(duties, together));
+        // one after the other they never overlap, the peak is the highest
+        // single channel
+        if(sum <= duties.period) {
+            CHECK_EQ(staggered, highest);
+            ++lower;
+        }
+    }
+    std::printf("%zu duty sets fit in a period and hit the lower bound\n",
+                lower);
+}
+
+/**
+ * @brief two channels that do not fit overlap by no more than they must
+ */
+void test_least_overlap() {
+    for(int run = 0; run < 2000; ++run) {
+        const auto duties = random_duties(2);
+        uint32_t hpoint[2];
+        stagger(duties.pulse, hpoint, 2, duties.period);
+        const uint32_t sum = duties.pulse[0] + duties.pulse[1];
+        CHECK_EQ(overlap(duties, hpoint),
+                 sum > duties.period ? sum - duties.period : 0);
+    }
+}
+
+}  // namespace
+
+
+int main() {
+    test_never_worse();
+    test_least_overlap();
+    return check::result();
+}
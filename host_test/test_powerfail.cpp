@@ -0,0 +1,209 @@
+/**
+ * @file test_powerfail.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief cuts the power in the middle of every flash write the power-fail
+ * path makes and checks the boot after sees it whole or not at all
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cstdint>
+#include <vector>
+
+#include "check.hpp"
+#include "record.hpp"
+
+using namespace powerfail;
+
+namespace {
+
+check::xorshift_t xorshift(0x9e3779b9);
+
+/**
+ * @brief call torn(word) for every word a cut programming of target over
+ * from can leave, some of the bits it had to move still where they were
+ * and some not
+ */
+template <typename torn_t>
+void for_each_tear(uint32_t from, uint32_t target, torn_t torn) {
+    const uint32_t moving = from ^ target;
+    // every subset of the bits left behind, but none, the complete write,
+    // and all, the write that never started
+    uint32_t left = (0 - moving) & moving;
+    while(left != 0 && left != moving) {
+        torn(target ^ left);
+        left = (left - moving) & moving;
+    }
+}
+
+void test_round_trip() {
+    for(int ch0 = 0; ch0 <= 100; ++ch0) {
+        for(int ch1 = 0; ch1 <= 100; ++ch1) {
+            uint8_t bris[2];
+            CHECK(decode(encode(ch0, ch1), bris));
+            CHECK_EQ(bris[0], ch0);
+            CHECK_EQ(bris[1], ch1);
+        }
+    }
+    uint8_t bris[2];
+    CHECK(!decode(erased_word, bris));
+    CHECK(!decode(dropped_word, bris));
+    // a latency is not a record, nor the other way around
+    CHECK(!decode(encode_latency(1234), bris));
+    uint16_t latency = 0;
+    CHECK(decode_word(encode_latency(1234), latency_magic, latency));
+    CHECK_EQ(latency, 1234);
+    CHECK(!decode_word(encode(1, 2), latency_magic, latency));
+    CHECK(decode_word(encode_latency(1000000), latency_magic, latency));
+    CHECK_EQ(latency, 0xffff);
+}
+
+/**
+ * @brief every torn program of a record, a latency, and every torn drop of
+ * a record, for a spread of values
+ */
+void test_tears() {
+    size_t tears = 0, accepted = 0;
+    const auto check_record = [&](uint32_t word) {
+        uint8_t bris[2];
+        ++tears;
+        accepted += decode(word, bris);
+    };
+    const auto check_latency = [&](uint32_t word) {
+        uint16_t latency = 0;
+        ++tears;
+        accepted += decode_word(word, latency_magic, latency);
+    };
+    for(int ch0 = 0; ch0 <= 100; ch0 += 5) {
+        for(int ch1 = 0; ch1 <= 100; ch1 += 5) {
+            const uint32_t record = encode(ch0, ch1);
+            for_each_tear(erased_word, record, check_record);
+            for_each_tear(record, dropped_word, check_record);
+            // an erase torn at boot brings the bits back the same way a
+            // torn program leaves them, it is the first case again
+        }
+    }
+    for(uint32_t us = 1; us < 0x10000; us = us * 3 + 1) {
+        for_each_tear(erased_word, encode_latency(us), check_latency);
+    }
+    CHECK_EQ(accepted, 0U);
+    std::printf("%zu torn words, %zu accepted\n", tears, accepted);
+}
+
+/**
+ * @brief a word programmed, which only clears bits
+ */
+struct program_t {
+    size_t index;
+    uint32_t word;
+};
+
+std::vector<uint32_t> erased(size_t num_slots) {
+    return std::vector<uint32_t>(num_slots * words_per_slot, erased_word);
+}
+
+struct scan_t {
+    bool found;
+    uint8_t bris[2];
+    uint32_t count;
+};
+
+scan_t scan(const std::vector<uint32_t> &words) {
+    scanner_t scanner;
+    for(const auto word : words) {
+        scanner.feed(word);
+    }
+    return {scanner.found(),
+            {scanner.bris()[0], scanner.bris()[1]},
+            scanner.stats().count};
+}
+
+bool same(const scan_t &a, const scan_t &b) {
+    return a.found == b.found && a.count == b.count
+           && (!a.found
+               || (a.bris[0] == b.bris[0] && a.bris[1] == b.bris[1]));
+}
+
+/**
+ * @brief a run of failures and persists as the writes they make, cut at
+ * every write with random tears: the boot after sees the state from before
+ * that write or after it, never anything else
+ */
+void test_cut_anywhere() {
+    constexpr size_t num_slots = 16;
+    size_t cuts                = 0;
+    for(int run = 0; run < 200; ++run) {
+        std::vector<program_t> ops;
+        size_t next_slot = 0, first_live = 0;
+        while(next_slot < num_slots) {
+            if(xorshift() % 3 == 0) {
+                // a persist drops the records still live
+                for(; first_live < next_slot; ++first_live) {
+                    const size_t index = first_live * words_per_slot;
+                    ops.push_back({index, dropped_word});
+                }
+                continue;
+            }
+            const size_t index = next_slot++ * words_per_slot;
+            const uint8_t ch0 = xorshift() % 101, ch1 = xorshift() % 101;
+            ops.push_back({index, encode(ch0, ch1)});
+            ops.push_back({index + 1, encode_latency(xorshift() % 3000)});
+        }
+
+        auto words = erased(num_slots);
+        for(const auto &op : ops) {
+            auto done         = words;
+            done[op.index]    = words[op.index] & op.word;
+            const auto before = scan(words);
+            const auto after  = scan(done);
+
+            // a handful of random tears of this write
+            const uint32_t moving = words[op.index] ^ done[op.index];
+            for(int i = 0; i < 8; ++i) {
+                auto torn = words;
+                torn[op.index] = done[op.index] | (moving & xorshift());
+                const auto result = scan(torn);
+                CHECK(same(result, before) || same(result, after));
+                ++cuts;
+            }
+            words = done;
+        }
+
+        // with every write done the last failure since the last persist is
+        // what comes back
+        const auto end = scan(words);
+        CHECK_EQ(end.count, num_slots);
+        CHECK_EQ(end.found, first_live < next_slot);
+    }
+    std::printf("%zu cuts, each seen whole or not at all\n", cuts);
+}
+
+/**
+ * @brief a glitch that leaves a record, then a newer value saved to the
+ * storage: the record is dropped and a reset later does not bring it back
+ */
+void test_glitch_then_persist() {
+    auto words = erased(4);
+    words[0] &= encode(80, 80);
+    words[1] &= encode_latency(500);
+    CHECK(scan(words).found);
+
+    words[0] &= dropped_word;
+    const auto result = scan(words);
+    CHECK(!result.found);
+    // the latency stays for the stats
+    CHECK_EQ(result.count, 1U);
+}
+
+}  // namespace
+
+
+int main() {
+    test_round_trip();
+    test_tears();
+    test_cut_anywhere();
+    test_glitch_then_persist();
+    return check::result();
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_scheduler.cpp
+ * @author Marco A. G. Maia (marcogmaia@gmail.com)
+ * @brief a week of thousands of schedule entries on a simulated clock, with
+ * the cost of every tick
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "check.hpp"
+#include "timeline.hpp"
+
+using namespace scheduler;
+
+namespace {
+
+constexpr time_t monday = 1792368000;  // 2026-10-19 00:00 UTC
+constexpr time_t week   = 7 * day_in_seconds;
+
+constexpr size_t num_entries = 4000;
+
+check::xorshift_t xorshift(0x12345678);
+
+entry_t random_entry() {
+    entry_t entry;
+    entry.days         = 1 + xorshift() % every_day;
+    entry.minute       = xorshift() % minutes_per_day;
+    entry.channel      = xorshift() % 2 ? leds::channel1 : leds::channel0;
+    entry.brightness   = xorshift() % 101;
+    entry.ramp_minutes = xorshift() % 4 == 0 ? xorshift() % 60 : 0;
+    return entry;
+}
+
+void test_valid() {
+    const entry_t good = {every_day, 7 * 60, leds::channel0, 80, 20};
+    CHECK(is_valid(good));
+
+    entry_t bad = good;
+    bad.days    = 0;
+    CHECK(!is_valid(bad));
+    bad.days = 0x80;
+    CHECK(!is_valid(bad));
+
+    bad        = good;
+    bad.minute = minutes_per_day;
+    CHECK(!is_valid(bad));
+
+    bad         = good;
+    bad.channel = static_cast<leds::channel_t>(7);
+    CHECK(!is_valid(bad));
+
+    bad            = good;
+    bad.brightness = 101;
+    CHECK(!is_valid(bad));
+}
+
+void test_ramp_before_midnight() {
+    // Tuesday 00:10 with a 30 minute ramp starts on Monday at 23:40
+    const entry_t entry = {1U << 2, 10, leds::channel0, 100, 30};
+    CHECK_EQ(next_start(entry, monday), monday + 23 * 3600 + 40 * 60);
+    // and the week after once that one passed
+    CHECK_EQ(next_start(entry, monday + 23 * 3600 + 40 * 60),
+             monday + week + 23 * 3600 + 40 * 60);
+}
+
+void test_clock_not_set() {
+    static timeline_t<4> timeline;
+    const entry_t entry = {every_day, 0, leds::channel0, 100, 0};
+    timeline.load(&entry, 1, 1000);
+    CHECK_EQ(timeline.size(), 0U);
+    CHECK_EQ(timeline.next(), 0);
+}
+
+/**
+ * @brief ticks where the device would, at each deadline, and checks every
+ * entry fires exactly when a scan of its own says so, at a cost per tick
+ * that grows with log n and not with n
+ */
+void test_week(size_t count) {
+    static timeline_t<num_entries> timeline;
+    std::vector<entry_t> entries(count);
+    std::vector<time_t> expected(count);  // next start of each, by itself
+    for(size_t i = 0; i < count; ++i) {
+        entries[i]  = random_entry();
+        expected[i] = next_start(entries[i], monday);
+    }
+    timeline.load(entries.data(), count, monday);
+    CHECK_EQ(timeline.size(), count);
+
+    const double levels = std::ceil(std::log2(static_cast<double>(count)));
+    size_t ticks = 0, fires = 0, total_work = 0, max_work = 0;
+    double max_work_per_fire = 0;
+    while(timeline.next() != 0 && timeline.next() <= monday + week) {
+        const time_t now = timeline.next();
+        const size_t done
+            = timeline.fire_due(entries.data(), now, [&](size_t i) {
+                  CHECK_EQ(expected[i], now);
+                  expected[i] = next_start(entries[i], now);
+              });
+        // the timer is only armed for a deadline, a tick never comes empty
+        CHECK(done > 0);
+        ++ticks;
+        fires += done;
+        total_work += timeline.work();
+        max_work = std::max(max_work, timeline.work());
+        max_work_per_fire = std::max(
+            max_work_per_fire, static_cast<double>(timeline.work()) / done);
+    }
+
+    // every start of the week came, and none was left behind
+    size_t missed = 0;
+    for(size_t i = 0; i < count; ++i) {
+        missed += expected[i] <= monday + week;
+    }
+    CHECK_EQ(missed, 0U);
+
+    // a pop and a push per entry fired, each walks the height of the heap
+    CHECK(max_work_per_fire <= 2 * levels + 2);
+    std::printf("%zu entries: %zu ticks, %zu fires, work per tick avg %.1f "
+                "max %zu, per fire max %.1f (log2 n = %.0f)\n",
+                count, ticks, fires, static_cast<double>(total_work) / ticks,
+                max_work, max_work_per_fire, levels);
+}
+
+}  // namespace
+
+
+int main() {
+    // next_start works in local time, keep it the same on every machine
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    test_valid();
+    test_ramp_before_midnight();
+    test_clock_not_set();
+    test_week(max_entries);
+    test_week(num_entries);
+    return check::result();
+}
@@ -15,13 +15,34 @@
 #include "freertos/task.h"
 
 #include "storage.hpp"
+#include "ambient.hpp"
+#include "effects.hpp"
+#include "event_loop.hpp"
 #include "leds.hpp"
+#include "loadgen.hpp"
+#include "powerfail.hpp"
+#include "scheduler.hpp"
+#include "static_alloc.hpp"
+#include "touch.hpp"
+#include "watchdog.hpp"
 #include "ble_server.h"
 
 constexpr auto *TAG = "MAIN";
 
 extern "C" void app_main(void) {
     storage::init();
+    event_loop::init();
+    powerfail::restore();
     leds::init();
+    powerfail::init();
+    watchdog::init();
+    scheduler::init();
+    effects::init();
+    ambient::init();
+    touch::init();
     nimble_ble_init();
+#if CONFIG_APP_LOADGEN
+    loadgen::init();
+#endif
+    static_alloc::report();
 }
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Make the light sensor traces host_test/test_ambient.cpp replays.
+
+With the log level of AMBIENT at debug, the device prints one
+"trace: <mV>" line per ADC frame. Save the monitor output and turn it into
+a trace with:
+
+    tools/ambient_trace.py capture monitor.log host_test/data/ambient/x.csv
+
+Every .csv in host_test/data/ambient/ is replayed by the host test, a new
+capture only has to be dropped in there.
+
+The traces checked in are synthetic, made with:
+
+    tools/ambient_trace.py synth host_test/data/ambient/
+
+A trace is one frame average in mV per line, lines starting with # are
+comments.
+"""
+
+import argparse
+import os
+import random
+import re
+import sys
+
+FRAME_HZ = 8000 / 1024  # sample_rate / frame_samples in ambient.cpp
+TRACE = re.compile(r"AMBIENT: trace: (\d+)")
+
+
+def capture(log, out):
+    values = [m.group(1) for m in map(TRACE.search, log) if m]
+    if not values:
+        sys.exit("no trace lines, is the AMBIENT log level at debug?")
+    out.write("# captured from a device\n")
+    out.write("\n".join(values) + "\n")
+
+
+def seconds(s):
+    return int(s * FRAME_HZ)
+
+
+def noisy(rng, mv, noise):
+    return max(0, round(mv + rng.uniform(-noise, noise)))
+
+
+def step(rng):
+    """A dark room and a lamp turned on after 10 s."""
+    return ([noisy(rng, 150, 20) for _ in range(seconds(10))]
+            + [noisy(rng, 1800, 40) for _ in range(seconds(30))])
+
+
+def dusk(rng):
+    """Daylight fading to dark over 10 minutes."""
+    n = seconds(600)
+    return [noisy(rng, 2400 - (2400 - 120) * i / n, 30) for i in range(n)]
+
+
+def flicker(rng):
+    """A steady light with the ripple of mains lighting and ADC noise."""
+    return [noisy(rng, 1200, 80) for _ in range(seconds(60))]
+
+
+TRACES = {"step": step, "dusk": dusk, "flicker": flicker}
+
+
+def synth(directory):
+    for name, make in TRACES.items():
+        rng = random.Random(name)
+        path = os.path.join(directory, name + ".csv")
+        with open(path, "w") as out:
+            out.write("# synthetic, tools/ambient_trace.py synth: "
+                      + make.__doc__ + "\n")
+            out.write("\n".join(map(str, make(rng))) + "\n")
+        print("wrote", path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+    cap = commands.add_parser("capture", help="trace from a monitor log")
+    cap.add_argument("log", type=argparse.FileType("r"))
+    cap.add_argument("out", type=argparse.FileType("w"))
+    syn = commands.add_parser("synth", help="write the synthetic traces")
+    syn.add_argument("directory")
+    args = parser.parse_args()
+
+    if args.command == "capture":
+        capture(args.log, args.out)
+    else:
+        synth(args.directory)
+
+
+if __name__ == "__main__":
+    main()
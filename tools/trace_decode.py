@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Decode a duty trace downloaded from the diagnostics characteristic.
+
+Select the trace page by writing b'\\x01' + cursor (uint32 LE, 0 for the
+oldest event), then read until the header cursor reaches the header head.
+Each read is an 8 byte header (cursor, head) followed by 8 byte events.
+Save the events, without the headers, one after the other, and run:
+
+    tools/trace_decode.py trace.bin [--csv] [--duty-max 32768]
+"""
+
+import argparse
+import struct
+import sys
+
+EVENT = struct.Struct("<IBBH")
+SOURCES = {0: "ble_write", 1: "leds_apply", 2: "persist"}
+BAR_WIDTH = 40
+
+
+def events(data):
+    usable = len(data) - len(data) % EVENT.size
+    for offset in range(0, usable, EVENT.size):
+        yield EVENT.unpack_from(data, offset)
+
+
+def percent(source, value, duty_max):
+    if source == 1:
+        return 100.0 * value / duty_max
+    return float(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", type=argparse.FileType("rb"))
+    parser.add_argument("--csv", action="store_true",
+                        help="one line per event, no bars")
+    parser.add_argument("--duty-max", type=int, default=1 << 15,
+                        help="full scale of leds_apply, leds::max_level")
+    args = parser.parse_args()
+
+    decoded = list(events(args.trace.read()))
+    if not decoded:
+        return 1
+    start = decoded[0][0]
+
+    if args.csv:
+        print("time_ms,source,channel,value,percent")
+    for timestamp, source, channel, value in decoded:
+        # the timestamp is the low 32 bits of esp_timer, it wraps every 71 min
+        time_ms = ((timestamp - start) & 0xffffffff) / 1000.0
+        name = SOURCES.get(source, str(source))
+        level = percent(source, value, args.duty_max)
+        if args.csv:
+            print(f"{time_ms:.3f},{name},{channel},{value},{level:.1f}")
+            continue
+        bar = "#" * round(min(max(level, 0), 100) * BAR_WIDTH / 100)
+        print(f"{time_ms:12.3f} ms  {name:<10} ch{channel} "
+              f"{value:5} |{bar:<{BAR_WIDTH}}|")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())